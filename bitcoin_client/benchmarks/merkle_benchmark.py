@@ -0,0 +1,78 @@
+"""
+Micro-benchmark comparing the node-based `MerkleTree` and the array-based `FlatMerkleTree`.
+
+Run from the `bitcoin_client` folder with:
+
+    python -m benchmarks.merkle_benchmark [--sizes 1000 10000 100000]
+
+For each number of leaves, it reports the time to build the tree, to compute the proofs of up to 1000 distinct leaves
+(on a freshly built tree, so that no proof is cached), to read the root, and the memory allocated by the tree.
+"""
+
+import argparse
+import os
+import random
+import time
+import tracemalloc
+from typing import Callable, List, Tuple
+
+from ledger_bitcoin.merkle import MerkleTree, FlatMerkleTree
+
+
+N_PROOFS = 1000
+N_ROOT_READS = 10000
+
+
+def timed(fn: Callable[[], object]) -> Tuple[float, object]:
+    start = time.perf_counter()
+    result = fn()
+    return time.perf_counter() - start, result
+
+
+def allocated_memory(fn: Callable[[], object]) -> int:
+    tracemalloc.start()
+    result = fn()  # keep the result alive while measuring
+    current, _ = tracemalloc.get_traced_memory()
+    tracemalloc.stop()
+    del result
+    return current
+
+
+def run(tree_class, leaves: List[bytes], indexes: List[int]) -> Tuple[float, float, float, int]:
+    t_build, tree = timed(lambda: tree_class(leaves))
+
+    t_proofs, proofs = timed(lambda: [tree.prove_leaf(i) for i in indexes])
+
+    t_root, root = timed(lambda: [tree.root for _ in range(N_ROOT_READS)])
+
+    memory = allocated_memory(lambda: tree_class(leaves))
+
+    return t_build, t_proofs / len(indexes), t_root / N_ROOT_READS, memory, root[0], proofs
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--sizes", type=int, nargs="+", default=[1000, 10000, 100000])
+    args = parser.parse_args()
+
+    random.seed(0)
+
+    print(f"{'leaves':>8} {'implementation':>15} {'build (ms)':>11} {'proof (us)':>11} {'root (us)':>10} {'memory (kB)':>12}")
+    for n in args.sizes:
+        leaves = [os.urandom(32) for _ in range(n)]
+        indexes = random.sample(range(n), min(n, N_PROOFS))
+
+        results = {}
+        for tree_class in [MerkleTree, FlatMerkleTree]:
+            t_build, t_proof, t_root, memory, root, proofs = run(tree_class, leaves, indexes)
+            results[tree_class] = (root, proofs)
+
+            print(f"{n:>8} {tree_class.__name__:>15} {1e3 * t_build:>11.1f} {1e6 * t_proof:>11.2f} "
+                  f"{1e6 * t_root:>10.3f} {memory / 1024:>12.0f}")
+
+        if results[MerkleTree] != results[FlatMerkleTree]:
+            raise RuntimeError(f"The two implementations disagree for {n} leaves")
+
+
+if __name__ == "__main__":
+    main()
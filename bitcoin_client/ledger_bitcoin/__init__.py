@@ -4,7 +4,8 @@
 from .client_base import Client, TransportClient
 from .client import createClient
 from .common import Chain
+from .native_transport import NativeTransportClient
 
 from .wallet import AddressType, Wallet, MultisigWallet, PolicyMapWallet
 
-__all__ = ["Client", "TransportClient", "createClient", "Chain", "AddressType", "Wallet", "MultisigWallet", "PolicyMapWallet"]
+__all__ = ["Client", "TransportClient", "NativeTransportClient", "createClient", "Chain", "AddressType", "Wallet", "MultisigWallet", "PolicyMapWallet"]
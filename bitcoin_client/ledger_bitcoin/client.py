@@ -1,11 +1,12 @@
 from sys import byteorder
 from typing import Tuple, List, Mapping, Optional, Union
 import base64
+import re
 from io import BytesIO, BufferedReader
 
-from .command_builder import BitcoinCommandBuilder, BitcoinInsType
-from .common import Chain
-from .client_command import ClientCommandInterpreter
+from .command_builder import BitcoinCommandBuilder, BitcoinInsType, FrameworkInsType
+from .common import ByteStreamParser, Chain
+from .client_command import ClientCommandInterpreter, ClientCommandCode
 from .client_base import Client, TransportClient
 from .client_legacy import LegacyClient
 from .exception import DeviceException
@@ -15,6 +16,12 @@ from .psbt import PSBT
 from ._serialize import deser_string
 
 
+def parse_version(version: str) -> Tuple[int, ...]:
+    """Returns the (major, minor, patch) numbers of a version string like "2.1.0"."""
+
+    return tuple(int(n) for n in re.findall(r"\d+", version)[:3])
+
+
 def parse_stream_to_map(f: BufferedReader) -> Mapping[bytes, bytes]:
     result = {}
     while True:
@@ -37,9 +44,16 @@ class NewClient(Client):
     # internal use for testing: if set to True, sign_psbt will not clone the psbt before converting to psbt version 2
     _no_clone_psbt: bool = False
 
-    def __init__(self, comm_client: TransportClient, chain: Chain = Chain.MAIN, debug: bool = False) -> None:
+    def __init__(self, comm_client: TransportClient, chain: Chain = Chain.MAIN, debug: bool = False,
+                 app_version: Optional[str] = None) -> None:
         super().__init__(comm_client, chain, debug)
-        self.builder = BitcoinCommandBuilder()
+
+        # the features of the protocol that the client uses depend on the version of the app
+        if app_version is None:
+            _, app_version, _ = self.get_version()
+        self.app_version = parse_version(app_version)
+
+        self.builder = BitcoinCommandBuilder(extended_client_commands=self.app_version >= (2, 1, 0))
 
     # Modifies the behavior of the base method by taking care of SW_INTERRUPTED_EXECUTION responses
     def _make_request(
@@ -192,9 +206,13 @@ class NewClient(Client):
         client_intepreter.add_known_list(input_commitments)
         client_intepreter.add_known_list(output_commitments)
 
+        # versions of the app before 2.1.0 do not support the PACK_SIGNATURES flag
+        pack_signatures = self.app_version >= (2, 1, 0)
+
         sw, _ = self._make_request(
             self.builder.sign_psbt(
-                global_map, input_maps, output_maps, wallet, wallet_hmac
+                global_map, input_maps, output_maps, wallet, wallet_hmac,
+                pack_signatures=pack_signatures
             ),
             client_intepreter,
         )
@@ -203,12 +221,26 @@ class NewClient(Client):
             raise DeviceException(error_code=sw, ins=BitcoinInsType.SIGN_PSBT)
 
         # parse results and return a structured version instead
-        results = client_intepreter.yielded
-
-        if any(len(x) <= 1 for x in results):
-            raise RuntimeError("Invalid response")
-
-        return {int(res[0]): res[1:] for res in results}
+        # If signatures are packed, each yielded result contains one or more signatures, each
+        # serialized as <input_index : varint> <len : 1> <signature : len>; otherwise, each
+        # yielded result is <input_index : varint> <signature>
+        signatures = {}
+        for res in client_intepreter.yielded:
+            parser = ByteStreamParser(res)
+            if parser.is_empty():
+                raise RuntimeError("Invalid response")
+            if not pack_signatures:
+                input_index = parser.read_varint()
+                signatures[input_index] = parser.read_bytes(len(res) - parser.stream.tell())
+                continue
+            while not parser.is_empty():
+                input_index = parser.read_varint()
+                sig_len = parser.read_uint(1)
+                if sig_len == 0:
+                    raise RuntimeError("Invalid response")
+                signatures[input_index] = parser.read_bytes(sig_len)
+
+        return signatures
 
     def get_master_fingerprint(self) -> bytes:
         sw, response = self._make_request(self.builder.get_master_fingerprint())
@@ -236,6 +268,39 @@ class NewClient(Client):
 
         return base64.b64encode(response).decode('utf-8')
 
+    def get_command_stats(self, reset: bool = False) -> dict:
+        """Returns the counters of the last command executed by the device, as a dict.
+
+        Only available if the app is compiled with COMMAND_STATS=1. The keys are `bytes_in` and `bytes_out` (total
+        size of the exchanged APDUs), `merkle_combine_hashes`, `bip32_derivations`, and `interruptions`, a dict
+        mapping each client command code to the number of times it was requested. If `reset` is True, the counters
+        are reset after reading them.
+        """
+        sw, response = self._make_request(self.builder.get_command_stats(reset))
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=FrameworkInsType.GET_COMMAND_STATS)
+
+        parser = ByteStreamParser(response)
+        stats = {
+            "bytes_in": parser.read_uint(4),
+            "bytes_out": parser.read_uint(4),
+            "merkle_combine_hashes": parser.read_uint(4),
+            "bip32_derivations": parser.read_uint(4),
+            "interruptions": {},
+        }
+        n_client_commands = parser.read_uint(1)
+        for _ in range(n_client_commands):
+            code = parser.read_uint(1)
+            try:
+                code = ClientCommandCode(code)
+            except ValueError:
+                pass  # unknown client command, keep the numeric code
+            stats["interruptions"][code] = parser.read_uint(4)
+        parser.assert_empty()
+
+        return stats
+
 
 def createClient(comm_client: Optional[TransportClient] = None, chain: Chain = Chain.MAIN, debug: bool = False) -> Union[LegacyClient, NewClient]:
     if comm_client is None:
@@ -244,6 +309,6 @@ def createClient(comm_client: Optional[TransportClient] = None, chain: Chain = C
     base_client = Client(comm_client, chain, debug)
     _, app_version, _ = base_client.get_version()
     if app_version >= "2":
-        return NewClient(comm_client, chain, debug)
+        return NewClient(comm_client, chain, debug, app_version)
     else:
         return LegacyClient(comm_client, chain, debug)
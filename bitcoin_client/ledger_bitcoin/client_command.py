@@ -4,7 +4,7 @@ from collections import deque
 from hashlib import sha256
 
 from .common import ByteStreamParser, sha256, write_varint
-from .merkle import MerkleTree, element_hash
+from .merkle import FlatMerkleTree, ceil_lg, element_hash
 
 
 class ClientCommandCode(IntEnum):
@@ -12,9 +12,42 @@ class ClientCommandCode(IntEnum):
     GET_PREIMAGE = 0x40
     GET_MERKLE_LEAF_PROOF = 0x41
     GET_MERKLE_LEAF_INDEX = 0x42
+    GET_MERKLE_LEAF_RANGE_PROOF = 0x43
+    GET_MERKLEIZED_MAP_VALUES = 0x44
+    GET_MERKLE_LEAF_ELEMENT = 0x45
     GET_MORE_ELEMENTS = 0xA0
 
 
+# Maximum number of bytes of elements in a response to GET_MORE_ELEMENTS: 255 bytes, minus the
+# 1-byte number of elements and the 1-byte element length
+MAX_MORE_ELEMENTS_PAYLOAD = 253
+
+
+class ByteChunk(bytes):
+    """A run of consecutive single-byte elements, kept in the queue as a single object.
+
+    Long preimages are returned to the hardware wallet 1 byte per element; storing each byte as a
+    separate object in the queue would be very inefficient for large preimages (like the
+    transactions in non-witness UTXOs).
+    """
+
+
+def enqueue_bytes(queue: "deque[bytes]", data: bytes) -> None:
+    """Adds to the queue the bytes of `data` as single-byte elements, in chunks that fill exactly
+    a response to GET_MORE_ELEMENTS."""
+
+    queue.extend(
+        ByteChunk(data[i: i + MAX_MORE_ELEMENTS_PAYLOAD])
+        for i in range(0, len(data), MAX_MORE_ELEMENTS_PAYLOAD)
+    )
+
+
+def element_len(el: bytes) -> int:
+    """Returns the length of the elements of an item of the queue."""
+
+    return 1 if isinstance(el, ByteChunk) else len(el)
+
+
 class ClientCommand:
     def execute(self, request: bytes) -> bytes:
         raise NotImplementedError("Subclasses should implement this method.")
@@ -68,13 +101,8 @@ class GetPreimageCommand(ClientCommand):
             payload_size = min(max_payload_size, len(known_preimage))
 
             if payload_size < len(known_preimage):
-                # split into list of length-1 bytes elements
-                extra_elements = [
-                    known_preimage[i: i + 1]
-                    for i in range(payload_size, len(known_preimage))
-                ]
-                # add to the queue any remaining extra bytes
-                self.queue.extend(extra_elements)
+                # add to the queue any remaining extra bytes, as length-1 bytes elements
+                enqueue_bytes(self.queue, known_preimage[payload_size:])
 
             return (
                 preimage_len_out
@@ -87,7 +115,7 @@ class GetPreimageCommand(ClientCommand):
 
 
 class GetMerkleLeafProofCommand(ClientCommand):
-    def __init__(self, known_trees: Mapping[bytes, MerkleTree], queue: "deque[bytes]"):
+    def __init__(self, known_trees: Mapping[bytes, FlatMerkleTree], queue: "deque[bytes]"):
         self.queue = queue
         self.known_trees = known_trees
 
@@ -101,12 +129,14 @@ class GetMerkleLeafProofCommand(ClientCommand):
         root = req.read_bytes(32)
         tree_size = req.read_varint()
         leaf_index = req.read_varint()
+        # optional: the device already knows the upper part of the proof
+        max_proof_size = None if req.is_empty() else req.read_uint(1)
         req.assert_empty()
 
         if not root in self.known_trees:
             raise ValueError(f"Unknown Merkle root: {root.hex()}.")
 
-        mt: MerkleTree = self.known_trees[root]
+        mt: FlatMerkleTree = self.known_trees[root]
 
         if leaf_index >= tree_size or len(mt) != tree_size:
             raise ValueError(f"Invalid index or tree size.")
@@ -117,6 +147,8 @@ class GetMerkleLeafProofCommand(ClientCommand):
             )
 
         proof = mt.prove_leaf(leaf_index)
+        if max_proof_size is not None:
+            proof = proof[:max_proof_size]
 
         # Compute how many elements we can fit in 255 - 32 - 1 - 1 = 221 bytes
         n_response_elements = min((255 - 32 - 1 - 1) // 32, len(proof))
@@ -136,8 +168,67 @@ class GetMerkleLeafProofCommand(ClientCommand):
         )
 
 
+class GetMerkleLeafRangeProofCommand(ClientCommand):
+    def __init__(self, known_trees: Mapping[bytes, FlatMerkleTree], queue: "deque[bytes]"):
+        self.queue = queue
+        self.known_trees = known_trees
+
+    @property
+    def code(self) -> int:
+        return ClientCommandCode.GET_MERKLE_LEAF_RANGE_PROOF
+
+    def execute(self, request: bytes) -> bytes:
+        req = ByteStreamParser(request[1:])
+
+        root = req.read_bytes(32)
+        tree_size = req.read_varint()
+        begin = req.read_varint()
+        n_leaves = req.read_uint(1)
+        max_proof_size = req.read_uint(1)
+        req.assert_empty()
+
+        if not root in self.known_trees:
+            raise ValueError(f"Unknown Merkle root: {root.hex()}.")
+
+        mt: FlatMerkleTree = self.known_trees[root]
+
+        if n_leaves == 0 or begin + n_leaves > tree_size or len(mt) != tree_size:
+            raise ValueError(f"Invalid range or tree size.")
+
+        # The range must be the set of leaves of a subtree
+        subtree_size = 1 << ceil_lg(n_leaves)
+        is_last_subtree = begin + n_leaves == tree_size
+        if begin % subtree_size != 0 or (n_leaves != subtree_size and not is_last_subtree):
+            raise ValueError(f"The requested range is not a subtree.")
+
+        if len(self.queue) != 0:
+            raise RuntimeError(
+                "This command should not execute when the queue is not empty."
+            )
+
+        # The requested leaves are all the leaves of a subtree, and the first leaf has depth
+        # ceil_lg(n_leaves) in it; the proof of the subtree is the rest of the proof of that leaf.
+        proof = mt.prove_leaf(begin)[ceil_lg(n_leaves):][:max_proof_size]
+
+        elements = [mt.get(i) for i in range(begin, begin + n_leaves)] + proof
+
+        # Compute how many elements we can fit in 255 - 1 - 1 = 253 bytes
+        n_response_elements = min((255 - 1 - 1) // 32, len(elements))
+
+        # Add to the queue any elements that do not fit the response
+        self.queue.extend(elements[n_response_elements:])
+
+        return b"".join(
+            [
+                len(proof).to_bytes(1, byteorder="big"),
+                n_response_elements.to_bytes(1, byteorder="big"),
+                *elements[:n_response_elements],
+            ]
+        )
+
+
 class GetMerkleLeafIndexCommand(ClientCommand):
-    def __init__(self, known_trees: Mapping[bytes, MerkleTree]):
+    def __init__(self, known_trees: Mapping[bytes, FlatMerkleTree]):
         self.known_trees = known_trees
 
     @property
@@ -164,6 +255,157 @@ class GetMerkleLeafIndexCommand(ClientCommand):
         return found.to_bytes(1, byteorder="big") + write_varint(leaf_index)
 
 
+class GetMerkleizedMapValuesCommand(ClientCommand):
+    def __init__(
+        self,
+        known_preimages: Mapping[bytes, bytes],
+        known_trees: Mapping[bytes, FlatMerkleTree],
+        queue: "deque[bytes]",
+    ):
+        self.queue = queue
+        self.known_preimages = known_preimages
+        self.known_trees = known_trees
+
+    @property
+    def code(self) -> int:
+        return ClientCommandCode.GET_MERKLEIZED_MAP_VALUES
+
+    def execute(self, request: bytes) -> bytes:
+        req = ByteStreamParser(request[1:])
+
+        keys_root = req.read_bytes(32)
+        values_root = req.read_bytes(32)
+        map_size = req.read_varint()
+        n_keys = req.read_uint(1)
+        key_hashes = [req.read_bytes(32) for _ in range(n_keys)]
+        req.assert_empty()
+
+        for root in [keys_root, values_root]:
+            if not root in self.known_trees:
+                raise ValueError(f"Unknown Merkle root: {root.hex()}.")
+
+        keys_tree: FlatMerkleTree = self.known_trees[keys_root]
+        values_tree: FlatMerkleTree = self.known_trees[values_root]
+
+        if len(keys_tree) != map_size or len(values_tree) != map_size:
+            raise ValueError(f"Invalid map size.")
+
+        if len(self.queue) != 0:
+            raise RuntimeError(
+                "This command should not execute when the queue is not empty."
+            )
+
+        header = bytearray()
+        elements = []
+        for key_hash in key_hashes:
+            try:
+                index = keys_tree.leaf_index(key_hash)
+            except ValueError:
+                header.append(0)
+                continue
+
+            value_hash = values_tree.get(index)
+            if not value_hash in self.known_preimages:
+                raise ValueError(f"Requested unknown preimage for: {value_hash.hex()}.")
+
+            # the known preimage is the leaf, prefixed with b'\0'
+            value = self.known_preimages[value_hash][1:]
+
+            header.append(1)
+            header.extend(write_varint(index))
+            header.extend(write_varint(len(value)))
+
+            elements.extend(keys_tree.prove_leaf(index))
+            for i in range(0, len(value), 32):
+                elements.append(value[i:i+32].ljust(32, b"\0"))
+            elements.extend(values_tree.prove_leaf(index))
+
+        # Compute how many elements we can fit in the rest of the 255 bytes
+        n_response_elements = min((255 - len(header) - 1) // 32, len(elements))
+
+        # Add to the queue any elements that do not fit the response
+        self.queue.extend(elements[n_response_elements:])
+
+        return b"".join(
+            [
+                bytes(header),
+                n_response_elements.to_bytes(1, byteorder="big"),
+                *elements[:n_response_elements],
+            ]
+        )
+
+
+class GetMerkleLeafElementCommand(ClientCommand):
+    def __init__(
+        self,
+        known_preimages: Mapping[bytes, bytes],
+        known_trees: Mapping[bytes, FlatMerkleTree],
+        queue: "deque[bytes]",
+    ):
+        self.queue = queue
+        self.known_preimages = known_preimages
+        self.known_trees = known_trees
+
+    @property
+    def code(self) -> int:
+        return ClientCommandCode.GET_MERKLE_LEAF_ELEMENT
+
+    def execute(self, request: bytes) -> bytes:
+        req = ByteStreamParser(request[1:])
+
+        root = req.read_bytes(32)
+        tree_size = req.read_varint()
+        leaf_index = req.read_varint()
+        max_proof_size = req.read_uint(1)
+        req.assert_empty()
+
+        if not root in self.known_trees:
+            raise ValueError(f"Unknown Merkle root: {root.hex()}.")
+
+        mt: FlatMerkleTree = self.known_trees[root]
+
+        if leaf_index >= tree_size or len(mt) != tree_size:
+            raise ValueError(f"Invalid index or tree size.")
+
+        leaf_hash = mt.get(leaf_index)
+        if not leaf_hash in self.known_preimages:
+            raise ValueError(f"Requested unknown preimage for: {leaf_hash.hex()}.")
+
+        if len(self.queue) != 0:
+            raise RuntimeError(
+                "This command should not execute when the queue is not empty."
+            )
+
+        # the known preimage is the leaf, prefixed with b'\0'
+        preimage = self.known_preimages[leaf_hash]
+        proof = mt.prove_leaf(leaf_index)[:max_proof_size]
+
+        preimage_len_out = write_varint(len(preimage))
+
+        # Send as much of the preimage as possible, and the proof only if the whole preimage fits
+        max_payload_size = 255 - len(preimage_len_out) - 1 - 1 - 1
+        n_preimage_bytes = min(max_payload_size, len(preimage))
+        if n_preimage_bytes == len(preimage):
+            n_proof_elements = min((max_payload_size - n_preimage_bytes) // 32, len(proof))
+        else:
+            n_proof_elements = 0
+
+        # Add to the queue the bytes of the preimage, then the proof elements, that do not fit
+        enqueue_bytes(self.queue, preimage[n_preimage_bytes:])
+        self.queue.extend(proof[n_proof_elements:])
+
+        return b"".join(
+            [
+                preimage_len_out,
+                len(proof).to_bytes(1, byteorder="big"),
+                n_preimage_bytes.to_bytes(1, byteorder="big"),
+                preimage[:n_preimage_bytes],
+                n_proof_elements.to_bytes(1, byteorder="big"),
+                *proof[:n_proof_elements],
+            ]
+        )
+
+
 class GetMoreElementsCommand(ClientCommand):
     def __init__(self, queue: "deque[bytes]"):
         self.queue = queue
@@ -179,25 +421,40 @@ class GetMoreElementsCommand(ClientCommand):
         if len(self.queue) == 0:
             raise ValueError("No elements to get.")
 
-        element_len = len(self.queue[0])
-        if any(len(el) != element_len for el in self.queue):
-            raise ValueError(
-                "The queue contains elements of different byte length, which is not expected."
-            )
+        # The queue can contain elements of different byte length (for example, the rest of a
+        # preimage followed by a Merkle proof); each response only contains elements of the same
+        # length as the first one.
+        el_len = element_len(self.queue[0])
 
         # pop from the queue, keeping the total response length at most 255
 
         response_elements = bytearray()
 
         n_added_elements = 0
-        while len(self.queue) > 0 and len(response_elements) + element_len <= 253:
-            response_elements.extend(self.queue.popleft())
-            n_added_elements += 1
+        while len(self.queue) > 0 and element_len(self.queue[0]) == el_len:
+            el = self.queue[0]
+            n_available = MAX_MORE_ELEMENTS_PAYLOAD - len(response_elements)
+            if isinstance(el, ByteChunk):
+                if n_available == 0:
+                    break
+                if len(el) > n_available:
+                    # only part of the chunk fits; the rest stays in the queue
+                    self.queue[0] = ByteChunk(el[n_available:])
+                    el = el[:n_available]
+                else:
+                    self.queue.popleft()
+                response_elements.extend(el)
+                n_added_elements += len(el)
+            else:
+                if el_len > n_available:
+                    break
+                response_elements.extend(self.queue.popleft())
+                n_added_elements += 1
 
         return b"".join(
             [
                 n_added_elements.to_bytes(1, byteorder="big"),
-                element_len.to_bytes(1, byteorder="big"),
+                el_len.to_bytes(1, byteorder="big"),
                 bytes(response_elements),
             ]
         )
@@ -213,7 +470,8 @@ class ClientCommandInterpreter:
     Moreover, it containes the state that is relevant for the interpreted client side commands:
     - a queue of bytes that contains any bytes that could not fit in a response from the
       GET_PREIMAGE client command (when a preimage is too long to fit in a single message) or the
-      GET_MERKLE_LEAF_PROOF command (which returns a Merkle proof, which might be too long to fit
+      GET_MERKLE_LEAF_PROOF, GET_MERKLE_LEAF_RANGE_PROOF, GET_MERKLEIZED_MAP_VALUES and
+      GET_MERKLE_LEAF_ELEMENT commands (which return Merkle proofs, which might be too long to fit
       in a single message). The data in the queue is returned in one (or more) successive
       GET_MORE_ELEMENTS commands from the hardware wallet.
 
@@ -229,7 +487,7 @@ class ClientCommandInterpreter:
 
     def __init__(self):
         self.known_preimages: Mapping[bytes, bytes] = {}
-        self.known_trees: Mapping[bytes, MerkleTree] = {}
+        self.known_trees: Mapping[bytes, FlatMerkleTree] = {}
 
         self.yielded: List[bytes] = []
 
@@ -240,6 +498,9 @@ class ClientCommandInterpreter:
             GetPreimageCommand(self.known_preimages, queue),
             GetMerkleLeafIndexCommand(self.known_trees),
             GetMerkleLeafProofCommand(self.known_trees, queue),
+            GetMerkleLeafRangeProofCommand(self.known_trees, queue),
+            GetMerkleizedMapValuesCommand(self.known_preimages, self.known_trees, queue),
+            GetMerkleLeafElementCommand(self.known_preimages, self.known_trees, queue),
             GetMoreElementsCommand(queue),
         ]
 
@@ -309,7 +570,7 @@ class ClientCommandInterpreter:
         for el in elements:
             self.add_known_preimage(b"\x00" + el)
 
-        mt = MerkleTree(element_hash(el) for el in elements)
+        mt = FlatMerkleTree(element_hash(el) for el in elements)
 
         self.known_trees[mt.root] = mt
 
@@ -2,7 +2,7 @@ import enum
 from typing import List, Tuple, Mapping, Union, Iterator, Optional
 
 from .common import bip32_path_from_string, AddressType, sha256, hash256, write_varint
-from .merkle import get_merkleized_map_commitment, MerkleTree, element_hash
+from .merkle import get_merkleized_map_commitment, FlatMerkleTree, element_hash
 from .wallet import Wallet
 
 
@@ -36,8 +36,17 @@ class BitcoinInsType(enum.IntEnum):
     GET_MASTER_FINGERPRINT = 0x05
     SIGN_MESSAGE = 0x10
 
+class P2Flags(enum.IntFlag):
+    """Flags in the P2 of all the commands with CLA_BITCOIN."""
+    CLIENT_EXTENDED_COMMANDS = 0x80
+
+class SignPsbtFlags(enum.IntFlag):
+    """Flags in the P2 of the SIGN_PSBT command."""
+    PACK_SIGNATURES = 0x01
+
 class FrameworkInsType(enum.IntEnum):
     CONTINUE_INTERRUPTED = 0x01
+    GET_COMMAND_STATS = 0x03
 
 
 class BitcoinCommandBuilder:
@@ -47,6 +56,16 @@ class BitcoinCommandBuilder:
     CLA_BITCOIN: int = 0xE1
     CLA_FRAMEWORK: int = 0xF8
 
+    def __init__(self, extended_client_commands: bool = False):
+        """
+        Parameters
+        ----------
+        extended_client_commands : bool
+            Whether the commands declare that the client supports the client commands added in version 2.1.0 of
+            the app. Must only be set if the app is at least at that version.
+        """
+        self.extended_client_commands = extended_client_commands
+
     def serialize(
         self,
         cla: int,
@@ -77,6 +96,9 @@ class BitcoinCommandBuilder:
 
         """
 
+        if cla == self.CLA_BITCOIN and self.extended_client_commands:
+            p2 |= P2Flags.CLIENT_EXTENDED_COMMANDS
+
         return {"cla": cla, "ins": ins, "p1": p1, "p2": p2, "data": cdata}
 
     def get_extended_pubkey(self, bip32_path: str, display: bool = False):
@@ -134,13 +156,14 @@ class BitcoinCommandBuilder:
         output_mappings: List[Mapping[bytes, bytes]],
         wallet: Wallet,
         wallet_hmac: Optional[bytes],
+        pack_signatures: bool = False,
     ):
 
         cdata = bytearray()
         cdata += get_merkleized_map_commitment(global_mapping)
 
         cdata += write_varint(len(input_mappings))
-        cdata += MerkleTree(
+        cdata += FlatMerkleTree(
             [
                 element_hash(get_merkleized_map_commitment(m_in))
                 for m_in in input_mappings
@@ -148,7 +171,7 @@ class BitcoinCommandBuilder:
         ).root
 
         cdata += write_varint(len(output_mappings))
-        cdata += MerkleTree(
+        cdata += FlatMerkleTree(
             [
                 element_hash(get_merkleized_map_commitment(m_out))
                 for m_out in output_mappings
@@ -158,8 +181,10 @@ class BitcoinCommandBuilder:
         cdata += wallet.id
         cdata += wallet_hmac if wallet_hmac is not None else b'\0' * 32
 
+        p2 = SignPsbtFlags.PACK_SIGNATURES if pack_signatures else 0
+
         return self.serialize(
-            cla=self.CLA_BITCOIN, ins=BitcoinInsType.SIGN_PSBT, cdata=bytes(cdata)
+            cla=self.CLA_BITCOIN, ins=BitcoinInsType.SIGN_PSBT, p2=p2, cdata=bytes(cdata)
         )
 
     def get_master_fingerprint(self):
@@ -182,7 +207,7 @@ class BitcoinCommandBuilder:
 
         cdata += write_varint(len(message))
 
-        cdata += MerkleTree(element_hash(c) for c in chunks).root
+        cdata += FlatMerkleTree(element_hash(c) for c in chunks).root
 
         return self.serialize(
             cla=self.CLA_BITCOIN,
@@ -204,3 +229,23 @@ class BitcoinCommandBuilder:
             ins=FrameworkInsType.CONTINUE_INTERRUPTED,
             cdata=cdata,
         )
+
+    def get_command_stats(self, reset: bool = False):
+        """Command builder for GET_COMMAND_STATS.
+
+        Parameters
+        ----------
+        reset : bool
+            Whether the counters should be reset after reading them.
+
+        Returns
+        -------
+        bytes
+            APDU command for GET_COMMAND_STATS.
+
+        """
+        return self.serialize(
+            cla=self.CLA_FRAMEWORK,
+            ins=FrameworkInsType.GET_COMMAND_STATS,
+            p1=1 if reset else 0,
+        )
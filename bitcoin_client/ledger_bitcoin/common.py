@@ -140,6 +140,9 @@ class ByteStreamParser:
         if self.stream.read(1) != b'':
             raise ValueError("Byte stream was expected to be empty")
 
+    def is_empty(self) -> bool:
+        return self.stream.tell() >= len(self.stream.getbuffer())
+
     def read_bytes(self, n: int) -> bytes:
         result = self.stream.read(n)
         if len(result) < n:
@@ -1,4 +1,5 @@
-from typing import List, Iterable, Mapping
+from bisect import insort
+from typing import Dict, List, Iterable, Mapping, Optional, Union
 
 from .common import write_varint, sha256
 
@@ -125,6 +126,9 @@ class MerkleTree:
     - There are always n - 1 internal nodes; all the internal nodes have exactly two children.
     - If a subtree has n > 1 leaves, then the left subchild is a complete subtree with p leaves, where p is the largest
       power of 2 smaller than n.
+
+    In order to answer queries efficiently, the tree also keeps an index from each leaf value to the (sorted) positions
+    where it appears, and caches the proofs computed since the last change.
     """
 
     def __init__(self, elements: Iterable[bytes] = []):
@@ -137,6 +141,12 @@ class MerkleTree:
             self.root_node = None
             self.depth = None
 
+        self._leaf_indexes: Dict[bytes, List[int]] = {}
+        for index, leaf in enumerate(self.leaves):
+            self._leaf_indexes.setdefault(leaf.value, []).append(index)
+
+        self._proofs: Dict[int, List[bytes]] = {}
+
     def __len__(self) -> int:
         """Return the total number of leaves in the tree."""
         return len(self.leaves)
@@ -158,25 +168,21 @@ class MerkleTree:
 
         new_leaf = Node(None, None, None, x)
         self.leaves.append(new_leaf)
+        self._leaf_indexes.setdefault(x, []).append(len(self.leaves) - 1)
+        self._proofs.clear()
         if len(self.leaves) == 1:
             self.root_node = new_leaf
             self.depth = 0
             return
 
-        # add a new leaf
-        if self.depth == 0:
-            ltree_size = 0
-        else:
-            # number of leaves of the left subtree of cur_root
-            ltree_size = 1 << (self.depth - 1)
-
+        # add a new leaf: find the largest complete subtree on the right border of the tree
         cur_root = self.root_node
         cur_root_size = len(self.leaves) - 1
 
         while not is_power_of_2(cur_root_size):
             cur_root = cur_root.right
-            cur_root_size -= ltree_size
-            ltree_size /= 2
+            # subtract the number of leaves of the left subtree of cur_root
+            cur_root_size -= largest_power_of_2_less_than(cur_root_size)
 
         # node value will be computed later
         new_node = Node(cur_root, new_leaf, cur_root.parent, None)
@@ -211,6 +217,13 @@ class MerkleTree:
         if index == len(self.leaves):
             self.add(x)
         else:
+            old_indexes = self._leaf_indexes[self.leaves[index].value]
+            old_indexes.remove(index)
+            if len(old_indexes) == 0:
+                del self._leaf_indexes[self.leaves[index].value]
+            insort(self._leaf_indexes.setdefault(x, []), index)
+            self._proofs.clear()
+
             self.leaves[index].value = x
             self.fix_up(self.leaves[index].parent)
 
@@ -224,27 +237,204 @@ class MerkleTree:
         return self.leaves[i].value
 
     def leaf_index(self, x: bytes) -> int:
-        """Return the index of the leaf with hash `x`. Raises `ValueError` if not found."""
-        idx = 0
-        while idx < len(self):
-            if self.leaves[idx].value == x:
-                return idx
-            idx += 1
-        raise ValueError("Leaf not found")
+        """Return the index of the leaf with hash `x`; if there are several, the smallest one.
+        Raises `ValueError` if not found. Cost O(1)."""
+        indexes = self._leaf_indexes.get(x)
+        if indexes is None:
+            raise ValueError("Leaf not found")
+        return indexes[0]
 
     def prove_leaf(self, index: int) -> List[bytes]:
-        """Produce the Merkle proof of membership for the leaf with the given index where 0 <= index < len(self)."""
-        node = self.leaves[index]
-        proof = []
-        while node.parent is not None:
-            sibling = node.sibling()
-            assert sibling is not None
+        """Produce the Merkle proof of membership for the leaf with the given index where 0 <= index < len(self).
+        Proofs are cached until the tree is modified."""
+        proof = self._proofs.get(index)
+        if proof is None:
+            node = self.leaves[index]
+            proof = []
+            while node.parent is not None:
+                sibling = node.sibling()
+                assert sibling is not None
 
-            proof.append(sibling.value)
+                proof.append(sibling.value)
 
-            node = node.parent
+                node = node.parent
+
+            self._proofs[index] = proof
+
+        return list(proof)
+
+
+class FlatMerkleTree:
+    """
+    Array-based implementation of the same dynamic vector and Merkle tree as `MerkleTree`, with the same interface,
+    root and proofs; it avoids allocating an object for each node, and it is faster to build for large trees.
+
+    The nodes are stored level by level: level 0 contains the leaves, and each node of level k + 1 is the hash of two
+    consecutive nodes of level k; if level k has an odd number of nodes, its last node is moved up to level k + 1
+    unchanged. This produces exactly the tree described in `MerkleTree`; a node that is moved up is the same node in
+    that tree, therefore it does not contribute any element to the proofs at that level.
+
+    Each level is stored as the concatenation of the 32-byte values of its nodes, in an immutable `bytes` object that is
+    only converted to a `bytearray` the first time that the level is modified.
+    """
+
+    def __init__(self, elements: Iterable[bytes] = []):
+        elements = [bytes(el) for el in elements]
+        if any(len(el) != 32 for el in elements):
+            raise ValueError("Inserted elements must be exactly 32 bytes long")
+
+        self.levels: List[Union[bytes, bytearray]] = [b''.join(elements)]
+        while len(self.levels[-1]) > 32:
+            level = self.levels[-1]
+            next_level = [sha256(b'\x01' + level[i: i + 64]) for i in range(0, len(level) - 32, 64)]
+            if len(level) % 64 == 32:
+                next_level.append(level[-32:])
+            self.levels.append(b''.join(next_level))
+
+        # index of the first leaf with each value
+        self._leaf_indexes: Dict[bytes, int] = {}
+        for index, el in enumerate(elements):
+            self._leaf_indexes.setdefault(el, index)
+
+        self._proofs: Dict[int, List[bytes]] = {}
+
+    def __len__(self) -> int:
+        """Return the total number of leaves in the tree."""
+        return len(self.levels[0]) // 32
+
+    @property
+    def depth(self) -> Optional[int]:
+        """Return the depth of the tree, or None if the tree is empty."""
+        return None if len(self) == 0 else len(self.levels) - 1
+
+    @property
+    def root(self) -> bytes:
+        """Return the Merkle root, or NIL if the tree is empty."""
+        levels = self.levels
+        return bytes(levels[-1]) if levels[0] else NIL
+
+    def copy(self):
+        """Return an identical copy of this Merkle tree."""
+        result = FlatMerkleTree()
+        result.levels = [bytes(level) for level in self.levels]
+        result._leaf_indexes = dict(self._leaf_indexes)
+        return result
+
+    def _mutable_level(self, k: int) -> bytearray:
+        if k == len(self.levels):
+            self.levels.append(bytearray())
+        elif not isinstance(self.levels[k], bytearray):
+            self.levels[k] = bytearray(self.levels[k])
+        return self.levels[k]
+
+    def _find_leaf(self, x: bytes, start: int) -> int:
+        """Return the index of the first leaf with value `x` starting from index `start`, or -1 if not found."""
+        leaves = self.levels[0]
+        pos = leaves.find(x, 32 * start)
+        while pos != -1 and pos % 32 != 0:
+            pos = leaves.find(x, pos + 1)
+        return -1 if pos == -1 else pos // 32
+
+    def _update_path(self, index: int) -> None:
+        """Recompute the ancestors of the leaf with the given index, adding new nodes or levels if needed."""
+
+        k = 1
+        while len(self.levels[k - 1]) > 32:
+            prev_level = self.levels[k - 1]
+            index //= 2
+
+            begin = 64 * index
+            if begin + 64 <= len(prev_level):
+                value = sha256(b'\x01' + prev_level[begin: begin + 64])
+            else:
+                value = prev_level[begin: begin + 32]  # no sibling, the node is moved up
+
+            self._mutable_level(k)[32 * index: 32 * index + 32] = value
+            k += 1
+
+    def add(self, x: bytes) -> None:
+        """Add an element as new leaf, and recompute the tree accordingly. Cost O(log n)."""
+
+        if len(x) != 32:
+            raise ValueError("Inserted elements must be exactly 32 bytes long")
+
+        index = len(self)
+        self._mutable_level(0).extend(x)
+        self._leaf_indexes.setdefault(bytes(x), index)
+        self._proofs.clear()
+
+        self._update_path(index)
+
+    def set(self, index: int, x: bytes) -> None:
+        """
+        Set the value of the leaf at position `index` to `x`, recomputing the tree accordingly.
+        If `index` equals the current number of leaves, then it is equivalent to `add(x)`.
+
+        Cost: O(log n), unless the leaf was the first one with its value, and other leaves have the same value; in that
+        case, finding the next one costs O(n).
+        """
+
+        if not (0 <= index <= len(self)):
+            raise ValueError(
+                "The index must be at least 0, and at most the current number of leaves.")
+
+        if len(x) != 32:
+            raise ValueError("Inserted elements must be exactly 32 bytes long.")
+
+        if index == len(self):
+            self.add(x)
+            return
+
+        x = bytes(x)
+        old_value = self.get(index)
+        self._mutable_level(0)[32 * index: 32 * index + 32] = x
+        self._proofs.clear()
+
+        if self._leaf_indexes[old_value] == index:
+            next_index = self._find_leaf(old_value, index + 1)
+            if next_index == -1:
+                del self._leaf_indexes[old_value]
+            else:
+                self._leaf_indexes[old_value] = next_index
+        if self._leaf_indexes.get(x, index) >= index:
+            self._leaf_indexes[x] = index
+
+        self._update_path(index)
+
+    def get(self, i: int) -> bytes:
+        """Return the value of the leaf with index `i`, where 0 <= i < len(self)."""
+        if not (0 <= i < len(self)):
+            raise IndexError("Leaf index out of range")
+        return bytes(self.levels[0][32 * i: 32 * i + 32])
+
+    def leaf_index(self, x: bytes) -> int:
+        """Return the index of the leaf with hash `x`; if there are several, the smallest one.
+        Raises `ValueError` if not found. Cost O(1)."""
+        index = self._leaf_indexes.get(x)
+        if index is None:
+            raise ValueError("Leaf not found")
+        return index
+
+    def prove_leaf(self, index: int) -> List[bytes]:
+        """Produce the Merkle proof of membership for the leaf with the given index where 0 <= index < len(self).
+        Proofs are cached until the tree is modified."""
+        if not (0 <= 32 * index < len(self.levels[0])):
+            raise IndexError("Leaf index out of range")
+
+        proof = self._proofs.get(index)
+        if proof is None:
+            proof = []
+            i = index
+            for level in self.levels:
+                sibling_begin = 32 * (i ^ 1)
+                sibling = level[sibling_begin: sibling_begin + 32]
+                if sibling:  # empty if the node has no sibling, including the root
+                    proof.append(bytes(sibling))
+                i >>= 1
+
+            self._proofs[index] = proof
 
-        return proof
+        return list(proof)
 
 
 def get_merkleized_map_commitment(mapping: Mapping[bytes, bytes]) -> bytes:
@@ -257,4 +447,4 @@ def get_merkleized_map_commitment(mapping: Mapping[bytes, bytes]) -> bytes:
     items_sorted = list(sorted(mapping.items()))
     keys_hashes = [element_hash(i[0]) for i in items_sorted]
     values_hashes = [element_hash(i[1]) for i in items_sorted]
-    return write_varint(len(mapping)) + MerkleTree(keys_hashes).root + MerkleTree(values_hashes).root
+    return write_varint(len(mapping)) + FlatMerkleTree(keys_hashes).root + FlatMerkleTree(values_hashes).root
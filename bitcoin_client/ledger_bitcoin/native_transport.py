@@ -0,0 +1,85 @@
+"""
+Transport that runs the core of the app in-process, from the library built in the host folder of the app's repository
+(see host/README.md there). It has the same interface as TransportClient, and can be used in its place, for example:
+
+    with createClient(NativeTransportClient("build-host/libbitcoin_app_host.so"), chain=Chain.TEST) as client:
+        ...
+
+Only the commands of the new protocol are supported, and the requests shown on screen are approved automatically
+(unless set_approve(False) is called).
+"""
+
+import ctypes
+import os
+from typing import Optional
+
+from .client_base import ApduException
+
+
+# Maximum length of a response, including the status word
+MAX_RESPONSE_LEN = 260
+
+
+class NativeTransportClient:
+    def __init__(self, library_path: Optional[str] = None, mnemonic: Optional[str] = None):
+        """Loads the library and starts the app.
+
+        Parameters
+        ----------
+        library_path : Optional[str]
+            Path of the library; if not given, the BITCOIN_APP_HOST_LIB environment variable is used.
+        mnemonic : Optional[str]
+            BIP-39 mnemonic of the seed; if not given, the default mnemonic of Speculos is used.
+        """
+
+        if library_path is None:
+            library_path = os.environ.get("BITCOIN_APP_HOST_LIB")
+            if library_path is None:
+                raise ValueError("The path of the library is not given, and BITCOIN_APP_HOST_LIB is not set")
+
+        self.lib = ctypes.CDLL(library_path)
+
+        self.lib.host_app_init.argtypes = [ctypes.c_char_p]
+        self.lib.host_app_init.restype = ctypes.c_int
+        self.lib.host_app_exchange.argtypes = [
+            ctypes.c_char_p, ctypes.c_size_t, ctypes.c_char_p, ctypes.POINTER(ctypes.c_size_t)
+        ]
+        self.lib.host_app_exchange.restype = ctypes.c_int
+        self.lib.host_app_set_approve.argtypes = [ctypes.c_bool]
+        self.lib.host_app_set_approve.restype = None
+
+        self._response = ctypes.create_string_buffer(MAX_RESPONSE_LEN)
+        self._response_len = ctypes.c_size_t(0)
+
+        if self.lib.host_app_init(None if mnemonic is None else mnemonic.encode()) != 0:
+            raise RuntimeError("Failed to start the app")
+
+    def set_approve(self, approve: bool) -> None:
+        """Sets whether the requests shown on screen are approved (the default) or rejected."""
+
+        self.lib.host_app_set_approve(approve)
+
+    def apdu_exchange(
+        self, cla: int, ins: int, data: bytes = b"", p1: int = 0, p2: int = 0
+    ) -> bytes:
+        if len(data) > 255:
+            raise ValueError("The data of an APDU can be at most 255 bytes long")
+
+        apdu = bytes([cla, ins, p1, p2, len(data)]) + data
+        if self.lib.host_app_exchange(apdu, len(apdu), self._response, ctypes.byref(self._response_len)) != 0:
+            raise RuntimeError("The app did not respond")
+
+        response = self._response.raw[:self._response_len.value]
+        sw = int.from_bytes(response[-2:], byteorder="big")
+        if sw != 0x9000:
+            raise ApduException(sw, response[:-2])
+
+        return response[:-2]
+
+    def apdu_exchange_nowait(
+        self, cla: int, ins: int, data: bytes = b"", p1: int = 0, p2: int = 0
+    ):
+        raise NotImplementedError()
+
+    def stop(self) -> None:
+        pass
@@ -4,7 +4,7 @@ from typing import List
 from hashlib import sha256
 
 from .common import serialize_str, AddressType, write_varint
-from .merkle import MerkleTree, element_hash
+from .merkle import FlatMerkleTree, element_hash
 
 class WalletType(IntEnum):
     POLICYMAP = 1
@@ -59,7 +59,7 @@ class PolicyMapWallet(Wallet):
             write_varint(len(self.policy_map)),
             self.policy_map.encode("latin-1"),
             write_varint(len(self.keys_info)),
-            MerkleTree(keys_info_hashes).root
+            FlatMerkleTree(keys_info_hashes).root
         ])
 
 
@@ -0,0 +1,854 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+/**
+ * Host implementation of the subset of the SDK's cryptographic library that is used by the app.
+ *
+ * SHA-256 and RIPEMD-160 are implemented here, as the app relies on the layout of their contexts
+ * (the digest is read back from the acc field); the arithmetic on secp256k1 uses OpenSSL.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// EC_GROUP_precompute_mult is deprecated, but still the only way to speed up k*G
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/obj_mac.h>
+#include <openssl/rand.h>
+
+#include "os.h"
+#include "cx.h"
+#include "cx_sha256.h"
+#include "cx_ripemd160.h"
+
+/* ------------------------------------------------------------------------- */
+/* SHA-256                                                                    */
+/* ------------------------------------------------------------------------- */
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static const uint32_t sha256_iv[8] = {0x6a09e667,
+                                      0xbb67ae85,
+                                      0x3c6ef372,
+                                      0xa54ff53a,
+                                      0x510e527f,
+                                      0x9b05688c,
+                                      0x1f83d9ab,
+                                      0x5be0cd19};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static uint32_t read_u32_be(const uint8_t *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static uint32_t read_u32_le(const uint8_t *p) {
+    return ((uint32_t) p[3] << 24) | ((uint32_t) p[2] << 16) | ((uint32_t) p[1] << 8) | p[0];
+}
+
+static void sha256_block(cx_sha256_t *ctx, const uint8_t block[static 64]) {
+    uint32_t state[8], w[64];
+    memcpy(state, ctx->acc, sizeof(state));
+
+    for (int i = 0; i < 16; i++) {
+        w[i] = read_u32_be(block + 4 * i);
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) + ((e & f) ^ (~e & g)) +
+                      sha256_k[i] + w[i];
+        uint32_t t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+
+    memcpy(ctx->acc, state, sizeof(state));
+    ++ctx->header.counter;
+}
+
+cx_err_t cx_sha256_init_no_throw(cx_sha256_t *hash) {
+    memset(hash, 0, sizeof(cx_sha256_t));
+    hash->header.algo = CX_SHA256;
+    memcpy(hash->acc, sha256_iv, sizeof(sha256_iv));
+    return CX_OK;
+}
+
+int cx_sha256_init(cx_sha256_t *hash) {
+    cx_sha256_init_no_throw(hash);
+    return CX_SHA256;
+}
+
+cx_err_t cx_sha256_update(cx_sha256_t *ctx, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        size_t n = sizeof(ctx->block) - ctx->blen;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(ctx->block + ctx->blen, data, n);
+        ctx->blen += n;
+        data += n;
+        len -= n;
+
+        if (ctx->blen == sizeof(ctx->block)) {
+            sha256_block(ctx, ctx->block);
+            ctx->blen = 0;
+        }
+    }
+    return CX_OK;
+}
+
+void cx_sha256_final(cx_sha256_t *ctx, uint8_t *digest) {
+    uint64_t bit_len = ((uint64_t) ctx->header.counter * 64 + ctx->blen) * 8;
+
+    ctx->block[ctx->blen++] = 0x80;
+    if (ctx->blen > 56) {
+        memset(ctx->block + ctx->blen, 0, 64 - ctx->blen);
+        sha256_block(ctx, ctx->block);
+        ctx->blen = 0;
+    }
+    memset(ctx->block + ctx->blen, 0, 56 - ctx->blen);
+    for (int i = 0; i < 8; i++) {
+        ctx->block[56 + i] = (uint8_t) (bit_len >> (56 - 8 * i));
+    }
+    sha256_block(ctx, ctx->block);
+    ctx->blen = 0;
+
+    // as in the SDK, the context keeps the digest; digest is allowed to overlap with acc
+    uint32_t state[8];
+    memcpy(state, ctx->acc, sizeof(state));
+    for (int i = 0; i < 8; i++) {
+        ctx->acc[4 * i] = (uint8_t) (state[i] >> 24);
+        ctx->acc[4 * i + 1] = (uint8_t) (state[i] >> 16);
+        ctx->acc[4 * i + 2] = (uint8_t) (state[i] >> 8);
+        ctx->acc[4 * i + 3] = (uint8_t) state[i];
+    }
+    memmove(digest, ctx->acc, 32);
+}
+
+int cx_hash_sha256(const unsigned char *in,
+                   unsigned int len,
+                   unsigned char *out,
+                   unsigned int out_len) {
+    if (out_len < 32) {
+        THROW(INVALID_PARAMETER);
+    }
+    cx_sha256_t ctx;
+    cx_sha256_init_no_throw(&ctx);
+    cx_sha256_update(&ctx, in, len);
+    cx_sha256_final(&ctx, out);
+    return 32;
+}
+
+/* ------------------------------------------------------------------------- */
+/* RIPEMD-160                                                                 */
+/* ------------------------------------------------------------------------- */
+
+static const uint8_t ripemd160_r[80] = {
+    0, 1, 2,  3,  4,  5,  6,  7,  8, 9, 10, 11, 12, 13, 14, 15, 7,  4,  13, 1,
+    10, 6, 15, 3,  12, 0,  9,  5,  2, 14, 11, 8, 3,  10, 14, 4,  9,  15, 8,  1,
+    2, 7, 0,  6,  13, 11, 5,  12, 1, 9, 11, 10, 0,  8,  12, 4,  13, 3,  7,  15,
+    14, 5, 6,  2,  4,  0,  5,  9,  7, 12, 2,  10, 14, 1,  3,  8,  11, 6,  15, 13};
+
+static const uint8_t ripemd160_rp[80] = {
+    5,  14, 7,  0, 9, 2,  11, 4,  13, 6,  15, 8,  1,  10, 3,  12, 6,  11, 3,  7,
+    0,  13, 5,  10, 14, 15, 8,  12, 4,  9,  1,  2,  15, 5,  1,  3,  7,  14, 6,  9,
+    11, 8,  12, 2,  10, 0,  4,  13, 8,  6,  4,  1,  3,  11, 15, 0,  5,  12, 2,  13,
+    9,  7,  10, 14, 12, 15, 10, 4,  1,  5,  8,  7,  6,  2,  13, 14, 0,  3,  9,  11};
+
+static const uint8_t ripemd160_s[80] = {
+    11, 14, 15, 12, 5,  8,  7,  9,  11, 13, 14, 15, 6,  7,  9,  8,  7,  6,  8,  13,
+    11, 9,  7,  15, 7,  12, 15, 9,  11, 7,  13, 12, 11, 13, 6,  7,  14, 9,  13, 15,
+    14, 8,  13, 6,  5,  12, 7,  5,  11, 12, 14, 15, 14, 15, 9,  8,  9,  14, 5,  6,
+    8,  6,  5,  12, 9,  15, 5,  11, 6,  8,  13, 12, 5,  12, 13, 14, 11, 8,  5,  6};
+
+static const uint8_t ripemd160_sp[80] = {
+    8,  9,  9,  11, 13, 15, 15, 5,  7,  7,  8,  11, 14, 14, 12, 6,  9,  13, 15, 7,
+    12, 8,  9,  11, 7,  7,  12, 7,  6,  15, 13, 11, 9,  7,  15, 11, 8,  6,  6,  14,
+    12, 13, 5,  14, 13, 13, 7,  5,  15, 5,  8,  11, 14, 14, 6,  14, 6,  9,  12, 9,
+    12, 5,  15, 8,  8,  5,  12, 9,  12, 5,  14, 6,  8,  13, 6,  5,  15, 13, 11, 11};
+
+static const uint32_t ripemd160_k[5] = {0x00000000, 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xa953fd4e};
+static const uint32_t ripemd160_kp[5] = {0x50a28be6, 0x5c4dd124, 0x6d703ef3, 0x7a6d76e9, 0x00000000};
+
+static const uint32_t ripemd160_iv[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+static uint32_t ripemd160_f(int j, uint32_t x, uint32_t y, uint32_t z) {
+    switch (j / 16) {
+        case 0:
+            return x ^ y ^ z;
+        case 1:
+            return (x & y) | (~x & z);
+        case 2:
+            return (x | ~y) ^ z;
+        case 3:
+            return (x & z) | (y & ~z);
+        default:
+            return x ^ (y | ~z);
+    }
+}
+
+static void ripemd160_block(cx_ripemd160_t *ctx, const uint8_t block[static 64]) {
+    uint32_t state[5], x[16];
+    memcpy(state, ctx->acc, sizeof(state));
+
+    for (int i = 0; i < 16; i++) {
+        x[i] = read_u32_le(block + 4 * i);
+    }
+
+    uint32_t al = state[0], bl = state[1], cl = state[2], dl = state[3], el = state[4];
+    uint32_t ar = al, br = bl, cr = cl, dr = dl, er = el;
+    for (int j = 0; j < 80; j++) {
+        uint32_t t = al + ripemd160_f(j, bl, cl, dl) + x[ripemd160_r[j]] + ripemd160_k[j / 16];
+        t = ROTL32(t, ripemd160_s[j]) + el;
+        al = el;
+        el = dl;
+        dl = ROTL32(cl, 10);
+        cl = bl;
+        bl = t;
+
+        t = ar + ripemd160_f(79 - j, br, cr, dr) + x[ripemd160_rp[j]] + ripemd160_kp[j / 16];
+        t = ROTL32(t, ripemd160_sp[j]) + er;
+        ar = er;
+        er = dr;
+        dr = ROTL32(cr, 10);
+        cr = br;
+        br = t;
+    }
+
+    uint32_t t = state[1] + cl + dr;
+    state[1] = state[2] + dl + er;
+    state[2] = state[3] + el + ar;
+    state[3] = state[4] + al + br;
+    state[4] = state[0] + bl + cr;
+    state[0] = t;
+
+    memcpy(ctx->acc, state, sizeof(state));
+    ++ctx->header.counter;
+}
+
+cx_err_t cx_ripemd160_init_no_throw(cx_ripemd160_t *hash) {
+    memset(hash, 0, sizeof(cx_ripemd160_t));
+    hash->header.algo = CX_RIPEMD160;
+    memcpy(hash->acc, ripemd160_iv, sizeof(ripemd160_iv));
+    return CX_OK;
+}
+
+cx_err_t cx_ripemd160_update(cx_ripemd160_t *ctx, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        size_t n = sizeof(ctx->block) - ctx->blen;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(ctx->block + ctx->blen, data, n);
+        ctx->blen += n;
+        data += n;
+        len -= n;
+
+        if (ctx->blen == sizeof(ctx->block)) {
+            ripemd160_block(ctx, ctx->block);
+            ctx->blen = 0;
+        }
+    }
+    return CX_OK;
+}
+
+cx_err_t cx_ripemd160_final(cx_ripemd160_t *ctx, uint8_t *digest) {
+    uint64_t bit_len = ((uint64_t) ctx->header.counter * 64 + ctx->blen) * 8;
+
+    ctx->block[ctx->blen++] = 0x80;
+    if (ctx->blen > 56) {
+        memset(ctx->block + ctx->blen, 0, 64 - ctx->blen);
+        ripemd160_block(ctx, ctx->block);
+        ctx->blen = 0;
+    }
+    memset(ctx->block + ctx->blen, 0, 56 - ctx->blen);
+    for (int i = 0; i < 8; i++) {
+        ctx->block[56 + i] = (uint8_t) (bit_len >> (8 * i));
+    }
+    ripemd160_block(ctx, ctx->block);
+    ctx->blen = 0;
+
+    uint32_t state[5];
+    memcpy(state, ctx->acc, sizeof(state));
+    for (int i = 0; i < 5; i++) {
+        ctx->acc[4 * i] = (uint8_t) state[i];
+        ctx->acc[4 * i + 1] = (uint8_t) (state[i] >> 8);
+        ctx->acc[4 * i + 2] = (uint8_t) (state[i] >> 16);
+        ctx->acc[4 * i + 3] = (uint8_t) (state[i] >> 24);
+    }
+    memmove(digest, ctx->acc, 20);
+    return CX_OK;
+}
+
+int cx_hash(cx_hash_t *hash,
+            int mode,
+            const unsigned char *in,
+            unsigned int len,
+            unsigned char *out,
+            unsigned int out_len) {
+    switch (hash->algo) {
+        case CX_SHA256:
+            cx_sha256_update((cx_sha256_t *) hash, in, len);
+            if (mode & CX_LAST) {
+                if (out_len < 32) {
+                    THROW(INVALID_PARAMETER);
+                }
+                cx_sha256_final((cx_sha256_t *) hash, out);
+                return 32;
+            }
+            return 0;
+        case CX_RIPEMD160:
+            cx_ripemd160_update((cx_ripemd160_t *) hash, in, len);
+            if (mode & CX_LAST) {
+                if (out_len < 20) {
+                    THROW(INVALID_PARAMETER);
+                }
+                cx_ripemd160_final((cx_ripemd160_t *) hash, out);
+                return 20;
+            }
+            return 0;
+        default:
+            THROW(INVALID_PARAMETER);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* HMAC                                                                       */
+/* ------------------------------------------------------------------------- */
+
+int cx_hmac_sha256(const unsigned char *key,
+                   unsigned int key_len,
+                   const unsigned char *in,
+                   unsigned int len,
+                   unsigned char *mac,
+                   unsigned int mac_len) {
+    uint8_t result[32];
+    if (HMAC(EVP_sha256(), key, key_len, in, len, result, NULL) == NULL) {
+        THROW(INVALID_PARAMETER);
+    }
+    if (mac_len > sizeof(result)) {
+        mac_len = sizeof(result);
+    }
+    memcpy(mac, result, mac_len);
+    return mac_len;
+}
+
+int cx_hmac_sha512(const unsigned char *key,
+                   unsigned int key_len,
+                   const unsigned char *in,
+                   unsigned int len,
+                   unsigned char *mac,
+                   unsigned int mac_len) {
+    uint8_t result[64];
+    if (HMAC(EVP_sha512(), key, key_len, in, len, result, NULL) == NULL) {
+        THROW(INVALID_PARAMETER);
+    }
+    if (mac_len > sizeof(result)) {
+        mac_len = sizeof(result);
+    }
+    memcpy(mac, result, mac_len);
+    return mac_len;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Big numbers                                                                */
+/* ------------------------------------------------------------------------- */
+
+static BN_CTX *bn_ctx() {
+    static BN_CTX *ctx = NULL;
+    if (ctx == NULL) {
+        ctx = BN_CTX_new();
+    }
+    return ctx;
+}
+
+static BIGNUM *bn_from(const uint8_t *a, size_t len) {
+    BIGNUM *bn = BN_bin2bn(a, len, NULL);
+    if (bn == NULL) {
+        THROW(EXCEPTION_OVERFLOW);
+    }
+    return bn;
+}
+
+static void bn_to(const BIGNUM *bn, uint8_t *r, size_t len) {
+    if (BN_bn2binpad(bn, r, len) < 0) {
+        THROW(EXCEPTION_OVERFLOW);
+    }
+}
+
+int cx_math_cmp(const unsigned char *a, const unsigned char *b, unsigned int length) {
+    return memcmp(a, b, length);
+}
+
+int cx_math_is_zero(const unsigned char *a, unsigned int len) {
+    for (unsigned int i = 0; i < len; i++) {
+        if (a[i] != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int cx_math_sub(unsigned char *r, const unsigned char *a, const unsigned char *b, unsigned int len) {
+    int borrow = 0;
+    for (int i = len - 1; i >= 0; i--) {
+        int d = a[i] - b[i] - borrow;
+        borrow = d < 0;
+        r[i] = (uint8_t) d;
+    }
+    return borrow;
+}
+
+void cx_math_addm(unsigned char *r,
+                  const unsigned char *a,
+                  const unsigned char *b,
+                  const unsigned char *m,
+                  unsigned int len) {
+    BIGNUM *bn_a = bn_from(a, len), *bn_b = bn_from(b, len), *bn_m = bn_from(m, len);
+    BN_mod_add(bn_a, bn_a, bn_b, bn_m, bn_ctx());
+    bn_to(bn_a, r, len);
+    BN_free(bn_a);
+    BN_free(bn_b);
+    BN_free(bn_m);
+}
+
+void cx_math_powm(unsigned char *r,
+                  const unsigned char *a,
+                  const unsigned char *e,
+                  unsigned int len_e,
+                  const unsigned char *m,
+                  unsigned int len) {
+    BIGNUM *bn_a = bn_from(a, len), *bn_e = bn_from(e, len_e), *bn_m = bn_from(m, len);
+    BN_mod_exp(bn_a, bn_a, bn_e, bn_m, bn_ctx());
+    bn_to(bn_a, r, len);
+    BN_free(bn_a);
+    BN_free(bn_e);
+    BN_free(bn_m);
+}
+
+/* ------------------------------------------------------------------------- */
+/* secp256k1                                                                  */
+/* ------------------------------------------------------------------------- */
+
+static const EC_GROUP *secp256k1() {
+    static EC_GROUP *group = NULL;
+    if (group == NULL) {
+        group = EC_GROUP_new_by_curve_name(NID_secp256k1);
+        // multiples of the generator, used by the (faster) non-constant-time multiplication
+        EC_GROUP_precompute_mult(group, bn_ctx());
+    }
+    return group;
+}
+
+static const BIGNUM *bn_zero() {
+    static BIGNUM *zero = NULL;
+    if (zero == NULL) {
+        zero = BN_new();
+        BN_zero(zero);
+    }
+    return zero;
+}
+
+// out = k*G + m*P. OpenSSL uses a constant-time ladder if only one of the two terms is given, and
+// the much faster wNAF method otherwise; timing attacks are not a concern in the host build.
+static void point_mul(EC_POINT *out, const BIGNUM *k, const EC_POINT *P, const BIGNUM *m) {
+    if (P == NULL) {
+        P = EC_GROUP_get0_generator(secp256k1());
+    }
+    EC_POINT_mul(secp256k1(), out, k ? k : bn_zero(), P, m ? m : bn_zero(), bn_ctx());
+}
+
+static void check_curve(cx_curve_t curve) {
+    if (curve != CX_CURVE_SECP256K1) {
+        THROW(INVALID_PARAMETER);
+    }
+}
+
+// Parses a point in the 65-byte uncompressed encoding; throws if it is not on the curve
+static EC_POINT *point_from(const uint8_t *encoded, size_t len) {
+    EC_POINT *p = EC_POINT_new(secp256k1());
+    if (EC_POINT_oct2point(secp256k1(), p, encoded, len, bn_ctx()) != 1) {
+        EC_POINT_free(p);
+        THROW(INVALID_PARAMETER);
+    }
+    return p;
+}
+
+// Encodes a point in the 65-byte uncompressed encoding; returns 0 for the point at infinity
+static int point_to(const EC_POINT *p, uint8_t out[static 65]) {
+    if (EC_POINT_is_at_infinity(secp256k1(), p)) {
+        return 0;
+    }
+    return EC_POINT_point2oct(secp256k1(), p, POINT_CONVERSION_UNCOMPRESSED, out, 65, bn_ctx());
+}
+
+int cx_ecfp_scalar_mult(cx_curve_t curve,
+                        unsigned char *P,
+                        unsigned int P_len,
+                        const unsigned char *k,
+                        unsigned int k_len) {
+    check_curve(curve);
+
+    EC_POINT *p = point_from(P, P_len);
+    BIGNUM *bn_k = bn_from(k, k_len);
+    point_mul(p, NULL, p, bn_k);
+    int ret = point_to(p, P);
+    EC_POINT_free(p);
+    BN_free(bn_k);
+    return ret;
+}
+
+int cx_ecfp_add_point(cx_curve_t curve,
+                      unsigned char *R,
+                      const unsigned char *P,
+                      const unsigned char *Q,
+                      unsigned int X_len) {
+    check_curve(curve);
+
+    EC_POINT *p = point_from(P, X_len), *q = point_from(Q, X_len);
+    EC_POINT_add(secp256k1(), p, p, q, bn_ctx());
+    int ret = point_to(p, R);
+    EC_POINT_free(p);
+    EC_POINT_free(q);
+    return ret;
+}
+
+int cx_ecfp_init_private_key(cx_curve_t curve,
+                             const unsigned char *rawkey,
+                             unsigned int key_len,
+                             cx_ecfp_private_key_t *pvkey) {
+    check_curve(curve);
+    if (key_len != 32 && key_len != 0) {
+        THROW(INVALID_PARAMETER);
+    }
+
+    pvkey->curve = curve;
+    pvkey->d_len = key_len;
+    if (rawkey != NULL) {
+        memmove(pvkey->d, rawkey, key_len);
+    }
+    return key_len;
+}
+
+// Computes k*G; returns 0 if k is not a valid scalar (zero, or not smaller than the group order)
+static int generator_mult(const uint8_t k[static 32], EC_POINT *out) {
+    BIGNUM *bn_k = bn_from(k, 32);
+    int ok = !BN_is_zero(bn_k) && BN_cmp(bn_k, EC_GROUP_get0_order(secp256k1())) < 0;
+    if (ok) {
+        point_mul(out, bn_k, NULL, NULL);
+    }
+    BN_free(bn_k);
+    return ok;
+}
+
+int cx_ecfp_generate_pair(cx_curve_t curve,
+                          cx_ecfp_public_key_t *pubkey,
+                          cx_ecfp_private_key_t *privkey,
+                          int keepprivate) {
+    check_curve(curve);
+
+    if (!keepprivate) {
+        do {
+            RAND_bytes(privkey->d, 32);
+        } while (cx_math_is_zero(privkey->d, 32));
+        privkey->curve = curve;
+        privkey->d_len = 32;
+    }
+
+    EC_POINT *p = EC_POINT_new(secp256k1());
+    if (!generator_mult(privkey->d, p)) {
+        EC_POINT_free(p);
+        THROW(INVALID_PARAMETER);
+    }
+    pubkey->curve = curve;
+    pubkey->W_len = point_to(p, pubkey->W);
+    EC_POINT_free(p);
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Signatures                                                                 */
+/* ------------------------------------------------------------------------- */
+
+// Appends to out the DER encoding of the 32-byte big-endian integer v; returns the new length
+static int der_append_integer(uint8_t *out, int offset, const uint8_t v[static 32]) {
+    int start = 0;
+    while (start < 31 && v[start] == 0) {
+        ++start;
+    }
+    int pad = (v[start] & 0x80) ? 1 : 0;
+    int len = 32 - start + pad;
+
+    out[offset++] = 0x02;
+    out[offset++] = (uint8_t) len;
+    if (pad) {
+        out[offset++] = 0x00;
+    }
+    memcpy(out + offset, v + start, 32 - start);
+    return offset + 32 - start;
+}
+
+static void hmac_sha256_2(const uint8_t key[static 32],
+                          const uint8_t *a,
+                          size_t a_len,
+                          const uint8_t *b,
+                          size_t b_len,
+                          uint8_t out[static 32]) {
+    uint8_t data[32 + 1 + 32 + 32];
+    memcpy(data, a, a_len);
+    memcpy(data + a_len, b, b_len);
+    cx_hmac_sha256(key, 32, data, a_len + b_len, out, 32);
+}
+
+int cx_ecdsa_sign(const cx_ecfp_private_key_t *pvkey,
+                  int mode,
+                  cx_md_t hashID,
+                  const unsigned char *hash,
+                  unsigned int hash_len,
+                  unsigned char *sig,
+                  unsigned int sig_len,
+                  unsigned int *info) {
+    (void) hashID;
+
+    if ((mode & CX_MASK_RND) != CX_RND_RFC6979 || hash_len != 32 || pvkey->d_len != 32 ||
+        sig_len < 72) {
+        THROW(INVALID_PARAMETER);
+    }
+
+    const BIGNUM *n = EC_GROUP_get0_order(secp256k1());
+    BIGNUM *d = bn_from(pvkey->d, 32);
+    BIGNUM *e = bn_from(hash, 32);
+    BIGNUM *k = BN_new(), *r = BN_new(), *s = BN_new(), *half_n = BN_new();
+    BIGNUM *x = BN_new(), *y = BN_new();
+    EC_POINT *R = EC_POINT_new(secp256k1());
+
+    // deterministic nonce, as in RFC 6979 section 3.2
+    uint8_t h1[32], V[32], K[32], t[32 + 1 + 32 + 32];
+    BN_nnmod(e, e, n, bn_ctx());
+    bn_to(e, h1, 32);
+
+    memset(V, 0x01, sizeof(V));
+    memset(K, 0x00, sizeof(K));
+    for (uint8_t i = 0; i < 2; i++) {
+        memcpy(t, V, 32);
+        t[32] = i;
+        memcpy(t + 33, pvkey->d, 32);
+        memcpy(t + 65, h1, 32);
+        cx_hmac_sha256(K, 32, t, sizeof(t), K, 32);
+        cx_hmac_sha256(K, 32, V, 32, V, 32);
+    }
+
+    unsigned int parity;
+    while (true) {
+        cx_hmac_sha256(K, 32, V, 32, V, 32);
+
+        if (generator_mult(V, R)) {
+            BN_bin2bn(V, 32, k);
+            EC_POINT_get_affine_coordinates(secp256k1(), R, x, y, bn_ctx());
+            parity = BN_is_odd(y) ? CX_ECCINFO_PARITY_ODD : 0;
+            if (BN_cmp(x, n) >= 0) {
+                parity |= CX_ECCINFO_xGTn;
+            }
+            BN_nnmod(r, x, n, bn_ctx());
+
+            // s = k^-1 * (e + r*d) mod n
+            BN_mod_mul(s, r, d, n, bn_ctx());
+            BN_mod_add(s, s, e, n, bn_ctx());
+            BN_mod_inverse(k, k, n, bn_ctx());
+            BN_mod_mul(s, s, k, n, bn_ctx());
+
+            if (!BN_is_zero(r) && !BN_is_zero(s)) {
+                break;
+            }
+        }
+
+        uint8_t zero = 0x00;
+        hmac_sha256_2(K, V, 32, &zero, 1, K);
+        cx_hmac_sha256(K, 32, V, 32, V, 32);
+    }
+
+    // canonical signature, with s <= n/2; negating s also negates the nonce point
+    BN_rshift1(half_n, n);
+    if (BN_cmp(s, half_n) > 0) {
+        BN_sub(s, n, s);
+        parity ^= CX_ECCINFO_PARITY_ODD;
+    }
+
+    uint8_t r_bytes[32], s_bytes[32];
+    bn_to(r, r_bytes, 32);
+    bn_to(s, s_bytes, 32);
+
+    int len = der_append_integer(sig, 2, r_bytes);
+    len = der_append_integer(sig, len, s_bytes);
+    sig[0] = 0x30;
+    sig[1] = (uint8_t) (len - 2);
+
+    if (info != NULL) {
+        *info = parity;
+    }
+
+    BN_clear_free(d);
+    BN_clear_free(k);
+    BN_free(e);
+    BN_free(r);
+    BN_free(s);
+    BN_free(half_n);
+    BN_free(x);
+    BN_free(y);
+    EC_POINT_free(R);
+    explicit_bzero(K, sizeof(K));
+    explicit_bzero(V, sizeof(V));
+    explicit_bzero(t, sizeof(t));
+
+    return len;
+}
+
+// SHA256(SHA256(tag) || SHA256(tag) || data1 || data2 || data3), as in BIP-0340
+static void bip340_tagged_hash(const char *tag,
+                               const uint8_t data1[static 32],
+                               const uint8_t *data2,
+                               const uint8_t *data3,
+                               uint8_t out[static 32]) {
+    uint8_t tag_hash[32];
+    cx_hash_sha256((const uint8_t *) tag, strlen(tag), tag_hash, 32);
+
+    cx_sha256_t ctx;
+    cx_sha256_init_no_throw(&ctx);
+    cx_sha256_update(&ctx, tag_hash, 32);
+    cx_sha256_update(&ctx, tag_hash, 32);
+    cx_sha256_update(&ctx, data1, 32);
+    if (data2 != NULL) {
+        cx_sha256_update(&ctx, data2, 32);
+    }
+    if (data3 != NULL) {
+        cx_sha256_update(&ctx, data3, 32);
+    }
+    cx_sha256_final(&ctx, out);
+}
+
+cx_err_t cx_ecschnorr_sign_no_throw(const cx_ecfp_private_key_t *pvkey,
+                                    uint32_t mode,
+                                    cx_md_t hashID,
+                                    const uint8_t *msg,
+                                    size_t msg_len,
+                                    uint8_t *sig,
+                                    size_t *sig_len) {
+    (void) hashID;
+
+    if ((mode & ~CX_MASK_RND) != CX_ECSCHNORR_BIP0340 || msg_len != 32 || pvkey->d_len != 32) {
+        return CX_INVALID_PARAMETER;
+    }
+
+    const BIGNUM *n = EC_GROUP_get0_order(secp256k1());
+    EC_POINT *P = EC_POINT_new(secp256k1()), *R = EC_POINT_new(secp256k1());
+    BIGNUM *d = bn_from(pvkey->d, 32), *k = BN_new(), *e = BN_new();
+    BIGNUM *x = BN_new(), *y = BN_new();
+    uint8_t px[32], rx[32], aux[32], t[32], buf[32];
+    cx_err_t err = CX_OK;
+
+    if (!generator_mult(pvkey->d, P)) {
+        err = CX_INVALID_PARAMETER;
+        goto end;
+    }
+    EC_POINT_get_affine_coordinates(secp256k1(), P, x, y, bn_ctx());
+    bn_to(x, px, 32);
+    if (BN_is_odd(y)) {
+        BN_sub(d, n, d);
+    }
+
+    // t = d xor hash_aux(a)
+    RAND_bytes(aux, sizeof(aux));
+    bip340_tagged_hash("BIP0340/aux", aux, NULL, NULL, t);
+    bn_to(d, buf, 32);
+    for (int i = 0; i < 32; i++) {
+        t[i] ^= buf[i];
+    }
+
+    // k = hash_nonce(t || P.x || m) mod n; R = kG, with k negated if R.y is odd
+    bip340_tagged_hash("BIP0340/nonce", t, px, msg, buf);
+    BN_bin2bn(buf, 32, k);
+    BN_nnmod(k, k, n, bn_ctx());
+    if (BN_is_zero(k)) {
+        err = CX_INVALID_PARAMETER;
+        goto end;
+    }
+    point_mul(R, k, NULL, NULL);
+    EC_POINT_get_affine_coordinates(secp256k1(), R, x, y, bn_ctx());
+    bn_to(x, rx, 32);
+    if (BN_is_odd(y)) {
+        BN_sub(k, n, k);
+    }
+
+    // e = hash_challenge(R.x || P.x || m) mod n; the signature is R.x || (k + e*d) mod n
+    bip340_tagged_hash("BIP0340/challenge", rx, px, msg, buf);
+    BN_bin2bn(buf, 32, e);
+    BN_nnmod(e, e, n, bn_ctx());
+    BN_mod_mul(e, e, d, n, bn_ctx());
+    BN_mod_add(e, e, k, n, bn_ctx());
+
+    memcpy(sig, rx, 32);
+    bn_to(e, sig + 32, 32);
+    *sig_len = 64;
+
+end:
+    BN_clear_free(d);
+    BN_clear_free(k);
+    BN_free(e);
+    BN_free(x);
+    BN_free(y);
+    EC_POINT_free(P);
+    EC_POINT_free(R);
+    explicit_bzero(t, sizeof(t));
+    explicit_bzero(buf, sizeof(buf));
+    return err;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Internal interface between the modules of the host build.
+ */
+
+/**
+ * Sets the seed used for all the key derivations.
+ */
+void host_os_set_seed(const uint8_t *seed, size_t seed_len);
+
+/**
+ * Starts running the given function in the app's context; it returns when the app calls
+ * io_exchange to receive the first APDU.
+ *
+ * @return 0 on success, a negative number otherwise.
+ */
+int host_io_start(void (*app_main)(void));
+
+/**
+ * Passes an APDU to the app, and runs it until it sends the response and waits for the next APDU.
+ *
+ * @return the length of the response, or a negative number if the app is not running.
+ */
+int host_io_exchange(const uint8_t *apdu, size_t apdu_len, uint8_t *response);
+
+/**
+ * Answers the request the app is showing on screen, if any, as the user would; returns false if
+ * there was none.
+ */
+bool host_ui_process_pending(void);
+
+/**
+ * Sets whether the requests shown on screen are approved or rejected.
+ */
+void host_ui_set_approve(bool approve);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * API of the host build of the app, that runs the app's core (the dispatcher, the command handlers
+ * and the common code) as a native library.
+ *
+ * The app runs in the calling thread; the functions are not thread-safe.
+ */
+
+// only the functions of this API are exported by the library
+#define HOST_APP_API __attribute__((visibility("default")))
+
+/**
+ * Starts the app, with the seed of the given BIP-39 mnemonic (without passphrase); if mnemonic is
+ * NULL, the default mnemonic of Speculos is used. Can be called again to restart the app.
+ *
+ * @return 0 on success, a negative number otherwise.
+ */
+HOST_APP_API int host_app_init(const char *mnemonic);
+
+/**
+ * Sends an APDU to the app, and returns its response, including the status word.
+ *
+ * @param[in] apdu
+ *   The APDU, including the 5-byte header.
+ * @param[in] apdu_len
+ *   Length of the APDU.
+ * @param[out] response
+ *   Buffer for the response; it must be at least HOST_APP_MAX_RESPONSE_LEN bytes long.
+ * @param[out] response_len
+ *   Set to the length of the response.
+ *
+ * @return 0 on success, a negative number if the app is not running, or if the APDU is invalid.
+ */
+HOST_APP_API int host_app_exchange(const uint8_t *apdu,
+                                   size_t apdu_len,
+                                   uint8_t *response,
+                                   size_t *response_len);
+
+/**
+ * Sets whether the user accepts (the default) or rejects the requests that the app shows on screen.
+ */
+HOST_APP_API void host_app_set_approve(bool approve);
+
+#define HOST_APP_MAX_RESPONSE_LEN 260
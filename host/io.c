@@ -0,0 +1,162 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+/**
+ * Host implementation of the I/O layer of the SDK.
+ *
+ * On the device, io_exchange blocks until the next APDU is received; the dispatcher relies on it,
+ * as interruptions are sent and answered in the middle of a command processor. In order to keep
+ * the app's code unchanged, the app runs as a coroutine with its own stack: io_exchange switches
+ * back to the host when the app waits for an APDU, and host_io_exchange switches to the app when
+ * the next APDU is available.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <ucontext.h>
+
+#include "os.h"
+#include "os_io_seproxyhal.h"
+#include "ux.h"
+
+#include "host.h"
+
+// the app's stack; the code of the app has no recursion, and it is much smaller on the device
+#define HOST_APP_STACK_SIZE (1024 * 1024)
+
+unsigned char G_io_apdu_buffer[IO_APDU_BUFFER_SIZE];
+io_seph_app_t G_io_app;
+volatile io_apdu_media_t G_io_apdu_media = IO_APDU_MEDIA_USB_HID;
+
+static struct {
+    ucontext_t host_context;
+    ucontext_t app_context;
+    uint8_t stack[HOST_APP_STACK_SIZE];
+
+    void (*app_main)(void);
+    bool running;
+
+    // APDU to be received by the app
+    uint8_t apdu[IO_APDU_BUFFER_SIZE];
+    size_t apdu_len;
+
+    // last response sent by the app, if any
+    uint8_t response[IO_APDU_BUFFER_SIZE];
+    int response_len;
+} G_host_io;
+
+static void app_entry() {
+    G_host_io.app_main();
+
+    // returning from this function resumes the host, as set in uc_link
+    G_host_io.running = false;
+}
+
+unsigned short io_exchange(unsigned char channel_and_flags, unsigned short tx_len) {
+    if (tx_len > 0) {
+        memcpy(G_host_io.response, G_io_apdu_buffer, tx_len);
+        G_host_io.response_len = tx_len;
+
+        if (channel_and_flags & IO_RETURN_AFTER_TX) {
+            return 0;
+        }
+    }
+
+    // wait for the next APDU
+    swapcontext(&G_host_io.app_context, &G_host_io.host_context);
+
+    memcpy(G_io_apdu_buffer, G_host_io.apdu, G_host_io.apdu_len);
+    G_io_app.apdu_length = G_host_io.apdu_len;
+    return G_host_io.apdu_len;
+}
+
+int host_io_start(void (*app_main)(void)) {
+    // if the app was already running, its context is simply discarded
+    if (getcontext(&G_host_io.app_context) != 0) {
+        return -1;
+    }
+    G_host_io.app_context.uc_stack.ss_sp = G_host_io.stack;
+    G_host_io.app_context.uc_stack.ss_size = sizeof(G_host_io.stack);
+    G_host_io.app_context.uc_link = &G_host_io.host_context;
+    makecontext(&G_host_io.app_context, app_entry, 0);
+
+    G_host_io.app_main = app_main;
+    G_host_io.running = true;
+    G_host_io.response_len = 0;
+
+    if (swapcontext(&G_host_io.host_context, &G_host_io.app_context) != 0) {
+        return -1;
+    }
+    return G_host_io.running ? 0 : -1;
+}
+
+int host_io_exchange(const uint8_t *apdu, size_t apdu_len, uint8_t *response) {
+    if (!G_host_io.running || apdu_len > sizeof(G_host_io.apdu)) {
+        return -1;
+    }
+
+    memcpy(G_host_io.apdu, apdu, apdu_len);
+    G_host_io.apdu_len = apdu_len;
+    G_host_io.response_len = 0;
+
+    swapcontext(&G_host_io.host_context, &G_host_io.app_context);
+
+    if (!G_host_io.running || G_host_io.response_len == 0) {
+        return -1;
+    }
+    memcpy(response, G_host_io.response, G_host_io.response_len);
+    return G_host_io.response_len;
+}
+
+// There is no secure element proxy on the host: the following functions do nothing
+
+void io_seproxyhal_init(void) {
+}
+
+void io_seproxyhal_general_status(void) {
+}
+
+unsigned int io_seproxyhal_spi_is_status_sent(void) {
+    return 1;
+}
+
+void io_seproxyhal_spi_send(const unsigned char *buffer, unsigned short length) {
+    (void) buffer;
+    (void) length;
+}
+
+unsigned short io_seproxyhal_spi_recv(unsigned char *buffer,
+                                      unsigned short maxlength,
+                                      unsigned int flags) {
+    (void) buffer;
+    (void) maxlength;
+    (void) flags;
+    return 0;
+}
+
+void io_seproxyhal_display_default(const bagl_element_t *element) {
+    (void) element;
+}
+
+void ux_flow_init(unsigned int stack_slot,
+                  const ux_flow_step_t *const *steps,
+                  const ux_flow_step_t *const start_step) {
+    (void) stack_slot;
+    (void) steps;
+    (void) start_step;
+}
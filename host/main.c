@@ -0,0 +1,229 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+/**
+ * Entry point of the host build: the same APDU loop as in src/main.c (for the new protocol only),
+ * and the API in host_app.h.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <openssl/evp.h>
+
+#include "os.h"
+#include "ux.h"
+
+#include "globals.h"
+#include "io.h"
+#include "sw.h"
+#include "ui/menu.h"
+#include "boilerplate/apdu_parser.h"
+#include "boilerplate/constants.h"
+#include "boilerplate/dispatcher.h"
+
+#include "commands.h"
+#include "crypto.h"
+#include "handler/lib/get_merkle_leaf_hash.h"
+#include "handler/lib/get_merkleized_map.h"
+#include "handler/lib/policy.h"
+
+#include "host.h"
+#include "host_app.h"
+
+// CLA and INS of the GET_VERSION command, that is processed by the OS on the device
+#define CLA_DEFAULT     0xB0
+#define INS_GET_VERSION 0x01
+
+#define DEFAULT_MNEMONIC                                                                   \
+    "glory promote mansion idle axis finger extra february uncover one trip resource lawn " \
+    "turtle enact monster seven myth punch hobby comfort wild raise skin"
+
+uint8_t G_io_seproxyhal_spi_buffer[IO_SEPROXYHAL_BUFFER_SIZE_B];
+ux_state_t G_ux;
+bolos_ux_params_t G_ux_params;
+
+command_state_t G_command_state;
+dispatcher_context_t G_dispatcher_context;
+
+global_context_t *G_coin_config;
+
+static global_context_t G_host_coin_config;
+
+// clang-format off
+static const command_descriptor_t COMMAND_DESCRIPTORS[] = {
+    {
+        .cla = CLA_APP,
+        .ins = GET_EXTENDED_PUBKEY,
+        .handler = (command_handler_t)handler_get_extended_pubkey
+    },
+    {
+        .cla = CLA_APP,
+        .ins = GET_WALLET_ADDRESS,
+        .handler = (command_handler_t)handler_get_wallet_address
+    },
+    {
+        .cla = CLA_APP,
+        .ins = REGISTER_WALLET,
+        .handler = (command_handler_t)handler_register_wallet
+    },
+    {
+        .cla = CLA_APP,
+        .ins = SIGN_PSBT,
+        .handler = (command_handler_t)handler_sign_psbt
+    },
+    {
+        .cla = CLA_APP,
+        .ins = GET_MASTER_FINGERPRINT,
+        .handler = (command_handler_t)handler_get_master_fingerprint
+    },
+    {
+        .cla = CLA_APP,
+        .ins = SIGN_MESSAGE,
+        .handler = (command_handler_t)handler_sign_message
+    },
+};
+// clang-format on
+
+// Same as init_coin_config in src/main.c, for the fields used by the new protocol
+static void init_coin_config(global_context_t *coin_config) {
+    memset(coin_config, 0, sizeof(global_context_t));
+
+    coin_config->bip32_pubkey_version = BIP32_PUBKEY_VERSION;
+    coin_config->bip44_coin_type = BIP44_COIN_TYPE;
+    coin_config->bip44_coin_type2 = BIP44_COIN_TYPE_2;
+    coin_config->p2pkh_version = COIN_P2PKH_VERSION;
+    coin_config->p2sh_version = COIN_P2SH_VERSION;
+    coin_config->family = COIN_FAMILY;
+    strcpy(coin_config->coinid, COIN_COINID);
+    strcpy(coin_config->name, COIN_COINID_NAME);
+    strcpy(coin_config->name_short, COIN_COINID_SHORT);
+#ifdef COIN_NATIVE_SEGWIT_PREFIX
+    strcpy(coin_config->native_segwit_prefix_val, COIN_NATIVE_SEGWIT_PREFIX);
+    coin_config->native_segwit_prefix = coin_config->native_segwit_prefix_val;
+#endif
+#ifdef COIN_FLAGS
+    coin_config->flags = COIN_FLAGS;
+#endif
+    coin_config->kind = COIN_KIND;
+}
+
+// Response: <format : 1> <name_len : 1> <name> <version_len : 1> <version> <flags_len : 1> <flags>
+static void handle_get_version() {
+    uint8_t response[3 + sizeof(APPNAME) + sizeof(APPVERSION)];
+    size_t offset = 0;
+
+    response[offset++] = 0x01;
+    response[offset++] = sizeof(APPNAME) - 1;
+    memcpy(response + offset, APPNAME, sizeof(APPNAME) - 1);
+    offset += sizeof(APPNAME) - 1;
+    response[offset++] = sizeof(APPVERSION) - 1;
+    memcpy(response + offset, APPVERSION, sizeof(APPVERSION) - 1);
+    offset += sizeof(APPVERSION) - 1;
+    response[offset++] = 1;
+    response[offset++] = 0x00;
+
+    io_send_response(response, offset, SW_OK);
+}
+
+static void host_app_main() {
+    for (;;) {
+        command_t cmd;
+
+        G_output_len = 0;
+
+        int input_len = io_exchange(CHANNEL_APDU | IO_ASYNCH_REPLY, 0);
+
+        memset(&cmd, 0, sizeof(cmd));
+        if (!apdu_parser(&cmd, G_io_apdu_buffer, input_len)) {
+            io_send_sw(SW_WRONG_DATA_LENGTH);
+            continue;
+        }
+
+        if (cmd.cla == CLA_DEFAULT && cmd.ins == INS_GET_VERSION) {
+            handle_get_version();
+            continue;
+        }
+
+        if (cmd.cla != CLA_FRAMEWORK || cmd.ins != INS_CONTINUE) {
+            // a new command is starting, forget the data verified in previous ones
+            merkle_cache_reset();
+            verified_maps_reset();
+            policy_keys_cache_reset();
+        }
+
+        apdu_dispatcher(COMMAND_DESCRIPTORS,
+                        sizeof(COMMAND_DESCRIPTORS) / sizeof(COMMAND_DESCRIPTORS[0]),
+                        (machine_context_t *) &G_command_state,
+                        sizeof(G_command_state),
+                        ui_menu_main,
+                        &cmd);
+
+        // on the device, the dispatcher is resumed by the UX once the user answers
+        while (host_ui_process_pending()) {
+        }
+    }
+}
+
+int host_app_init(const char *mnemonic) {
+    if (mnemonic == NULL) {
+        mnemonic = DEFAULT_MNEMONIC;
+    }
+
+    // BIP-39 seed, with an empty passphrase
+    uint8_t seed[64];
+    if (PKCS5_PBKDF2_HMAC(mnemonic,
+                          strlen(mnemonic),
+                          (const unsigned char *) "mnemonic",
+                          8,
+                          2048,
+                          EVP_sha512(),
+                          sizeof(seed),
+                          seed) != 1) {
+        return -1;
+    }
+    host_os_set_seed(seed, sizeof(seed));
+    explicit_bzero(seed, sizeof(seed));
+
+    init_coin_config(&G_host_coin_config);
+    G_coin_config = &G_host_coin_config;
+
+    try_context_set(NULL);
+    explicit_bzero(&G_command_state, sizeof(G_command_state));
+    explicit_bzero(&G_dispatcher_context, sizeof(G_dispatcher_context));
+    crypto_pubkeys_cache_reset();
+    io_reset_timeouts();
+    host_ui_set_approve(true);
+
+    return host_io_start(host_app_main);
+}
+
+int host_app_exchange(const uint8_t *apdu,
+                      size_t apdu_len,
+                      uint8_t *response,
+                      size_t *response_len) {
+    int len = host_io_exchange(apdu, apdu_len, response);
+    if (len < 0) {
+        return -1;
+    }
+    *response_len = len;
+    return 0;
+}
+
+void host_app_set_approve(bool approve) {
+    host_ui_set_approve(approve);
+}
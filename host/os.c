@@ -0,0 +1,181 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+/**
+ * Host implementation of the syscalls of the OS that are used by the app: the key derivations from
+ * the seed, and the exception contexts.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "os.h"
+#include "cx.h"
+
+#include "host.h"
+
+static uint8_t G_host_seed[64];
+static size_t G_host_seed_len;
+
+static try_context_t *G_host_try_context;
+
+void host_os_set_seed(const uint8_t *seed, size_t seed_len) {
+    if (seed_len > sizeof(G_host_seed)) {
+        seed_len = sizeof(G_host_seed);
+    }
+    memcpy(G_host_seed, seed, seed_len);
+    G_host_seed_len = seed_len;
+}
+
+void *pic(void *linked_address) {
+    return linked_address;
+}
+
+void halt() {
+    fprintf(stderr, "halt() called\n");
+    abort();
+}
+
+try_context_t *try_context_get(void) {
+    return G_host_try_context;
+}
+
+try_context_t *try_context_set(try_context_t *context) {
+    try_context_t *previous = G_host_try_context;
+    G_host_try_context = context;
+    return previous;
+}
+
+void os_longjmp(unsigned int exception) {
+    if (G_host_try_context == NULL) {
+        fprintf(stderr, "Uncaught exception 0x%04x\n", exception);
+        abort();
+    }
+    longjmp(G_host_try_context->jmp_buf, exception);
+}
+
+bolos_bool_t os_global_pin_is_validated(void) {
+    return BOLOS_UX_OK;
+}
+
+char os_secure_memcmp(void *src1, void *src2, unsigned int length) {
+    uint8_t diff = 0;
+    for (unsigned int i = 0; i < length; i++) {
+        diff |= ((uint8_t *) src1)[i] ^ ((uint8_t *) src2)[i];
+    }
+    return diff;
+}
+
+// Derives the BIP-32 private key and chain code at the given path
+static void derive_bip32(const uint32_t *path,
+                         unsigned int path_len,
+                         uint8_t private_key[static 32],
+                         uint8_t chain_code[static 32]) {
+    static const uint8_t secp256k1_n[32] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfe,
+        0xba, 0xae, 0xdc, 0xe6, 0xaf, 0x48, 0xa0, 0x3b, 0xbf, 0xd2, 0x5e, 0x8c, 0xd0, 0x36, 0x41, 0x41};
+
+    uint8_t I[64];
+    cx_hmac_sha512((const uint8_t *) "Bitcoin seed", 12, G_host_seed, G_host_seed_len, I, 64);
+
+    for (unsigned int i = 0; i < path_len; i++) {
+        // data is 0x00 || k_par for hardened children, serP(point(k_par)) otherwise; then ser32(i)
+        uint8_t data[33 + 4];
+        if (path[i] & 0x80000000u) {
+            data[0] = 0x00;
+            memcpy(data + 1, I, 32);
+        } else {
+            cx_ecfp_private_key_t private_key_obj;
+            cx_ecfp_public_key_t public_key;
+            cx_ecfp_init_private_key(CX_CURVE_256K1, I, 32, &private_key_obj);
+            cx_ecfp_generate_pair(CX_CURVE_256K1, &public_key, &private_key_obj, 1);
+            data[0] = 0x02 + (public_key.W[64] & 1);
+            memcpy(data + 1, public_key.W + 1, 32);
+            explicit_bzero(&private_key_obj, sizeof(private_key_obj));
+        }
+        data[33] = (uint8_t) (path[i] >> 24);
+        data[34] = (uint8_t) (path[i] >> 16);
+        data[35] = (uint8_t) (path[i] >> 8);
+        data[36] = (uint8_t) path[i];
+
+        uint8_t k_par[32];
+        memcpy(k_par, I, 32);
+        cx_hmac_sha512(I + 32, 32, data, sizeof(data), I, 64);
+
+        // k_i = I_L + k_par (mod n); an invalid I_L has negligible probability, and is not handled
+        cx_math_addm(I, I, k_par, secp256k1_n, 32);
+
+        explicit_bzero(k_par, sizeof(k_par));
+        explicit_bzero(data, sizeof(data));
+    }
+
+    memcpy(private_key, I, 32);
+    memcpy(chain_code, I + 32, 32);
+    explicit_bzero(I, sizeof(I));
+}
+
+void os_perso_derive_node_bip32(cx_curve_t curve,
+                                const unsigned int *path,
+                                unsigned int pathLength,
+                                unsigned char *privateKey,
+                                unsigned char *chain) {
+    if (curve != CX_CURVE_256K1) {
+        THROW(INVALID_PARAMETER);
+    }
+
+    uint8_t chain_code[32];
+    derive_bip32(path, pathLength, privateKey, chain_code);
+    if (chain != NULL) {
+        memcpy(chain, chain_code, 32);
+    }
+}
+
+void os_perso_derive_node_with_seed_key(unsigned int mode,
+                                        cx_curve_t curve,
+                                        const unsigned int *path,
+                                        unsigned int pathLength,
+                                        unsigned char *privateKey,
+                                        unsigned char *chain,
+                                        unsigned char *seed_key,
+                                        unsigned int seed_key_length) {
+    if (mode != HDW_SLIP21) {
+        os_perso_derive_node_bip32(curve, path, pathLength, privateKey, chain);
+        return;
+    }
+    (void) seed_key;
+    (void) seed_key_length;
+
+    // SLIP-0021: the label (path) starts with the 0x00 byte, and only one level is supported
+    const uint8_t *label = (const uint8_t *) path;
+    if (pathLength == 0 || label[0] != 0x00) {
+        THROW(INVALID_PARAMETER);
+    }
+
+    uint8_t node[64];
+    cx_hmac_sha512((const uint8_t *) "Symmetric key seed",
+                   18,
+                   G_host_seed,
+                   G_host_seed_len,
+                   node,
+                   64);
+    cx_hmac_sha512(node, 32, label, pathLength, node, 64);
+
+    memcpy(privateKey, node + 32, 32);
+    explicit_bzero(node, sizeof(node));
+}
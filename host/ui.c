@@ -0,0 +1,172 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+/**
+ * Host replacement of src/ui: nothing is shown, and each request is answered as soon as the
+ * dispatcher is paused, with the answer set with host_app_set_approve.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ui/display.h"
+#include "ui/menu.h"
+
+#include "host.h"
+
+extern dispatcher_context_t G_dispatcher_context;
+
+static action_validate_cb G_host_ui_callback;
+static bool G_host_ui_approve = true;
+
+static void set_pending(action_validate_cb callback) {
+    G_host_ui_callback = callback;
+}
+
+bool host_ui_process_pending(void) {
+    action_validate_cb callback = G_host_ui_callback;
+    if (callback == NULL) {
+        return false;
+    }
+
+    // the callback might show the next request
+    G_host_ui_callback = NULL;
+    callback(&G_dispatcher_context, G_host_ui_approve);
+    return true;
+}
+
+void host_ui_set_approve(bool approve) {
+    G_host_ui_approve = approve;
+}
+
+void ui_menu_main(void) {
+    G_host_ui_callback = NULL;
+}
+
+void ui_menu_about(void) {
+}
+
+void ui_display_pubkey(dispatcher_context_t *dispatcher_context,
+                       char *bip32_path_str,
+                       bool is_path_suspicious,
+                       char *pubkey,
+                       action_validate_cb callback) {
+    (void) dispatcher_context;
+    (void) bip32_path_str;
+    (void) is_path_suspicious;
+    (void) pubkey;
+    set_pending(callback);
+}
+
+void ui_display_message_hash(dispatcher_context_t *context,
+                             char *bip32_path_str,
+                             char *message_hash,
+                             action_validate_cb callback) {
+    (void) context;
+    (void) bip32_path_str;
+    (void) message_hash;
+    set_pending(callback);
+}
+
+void ui_display_address(dispatcher_context_t *dispatcher_context,
+                        char *address,
+                        bool is_path_suspicious,
+                        char *bip32_path_str,
+                        action_validate_cb callback) {
+    (void) dispatcher_context;
+    (void) address;
+    (void) is_path_suspicious;
+    (void) bip32_path_str;
+    set_pending(callback);
+}
+
+void ui_display_wallet_header(dispatcher_context_t *context,
+                              policy_map_wallet_header_t *wallet_header,
+                              action_validate_cb callback) {
+    (void) context;
+    (void) wallet_header;
+    set_pending(callback);
+}
+
+void ui_display_policy_map_cosigner_pubkey(dispatcher_context_t *dispatcher_context,
+                                           char *pubkey,
+                                           uint8_t cosigner_index,
+                                           uint8_t n_keys,
+                                           bool is_internal,
+                                           action_validate_cb callback) {
+    (void) dispatcher_context;
+    (void) pubkey;
+    (void) cosigner_index;
+    (void) n_keys;
+    (void) is_internal;
+    set_pending(callback);
+}
+
+void ui_display_wallet_address(dispatcher_context_t *context,
+                               char *wallet_name,
+                               char *address,
+                               action_validate_cb callback) {
+    (void) context;
+    (void) wallet_name;
+    (void) address;
+    set_pending(callback);
+}
+
+void ui_display_unusual_path(dispatcher_context_t *context,
+                             char *bip32_path_str,
+                             action_validate_cb callback) {
+    (void) context;
+    (void) bip32_path_str;
+    set_pending(callback);
+}
+
+void ui_authorize_wallet_spend(dispatcher_context_t *context,
+                               char *wallet_name,
+                               action_validate_cb callback) {
+    (void) context;
+    (void) wallet_name;
+    set_pending(callback);
+}
+
+void ui_warn_external_inputs(dispatcher_context_t *context, action_validate_cb callback) {
+    (void) context;
+    set_pending(callback);
+}
+
+void ui_validate_output(dispatcher_context_t *context,
+                        int index,
+                        char *address,
+                        char *coin_name,
+                        uint64_t amount,
+                        action_validate_cb callback) {
+    (void) context;
+    (void) index;
+    (void) address;
+    (void) coin_name;
+    (void) amount;
+    set_pending(callback);
+}
+
+void ui_validate_transaction(dispatcher_context_t *context,
+                             char *coin_name,
+                             uint64_t fee,
+                             action_validate_cb callback) {
+    (void) context;
+    (void) coin_name;
+    (void) fee;
+    set_pending(callback);
+}
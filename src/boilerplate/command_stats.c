@@ -0,0 +1,78 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#ifdef HAVE_COMMAND_STATS
+
+#include <stdint.h>
+#include <string.h>
+
+#include "command_stats.h"
+#include "io.h"
+#include "sw.h"
+
+#include "common/buffer.h"
+
+command_stats_t G_command_stats;
+
+void command_stats_reset() {
+    memset(&G_command_stats, 0, sizeof(G_command_stats));
+}
+
+void command_stats_add_interruption(uint8_t client_command) {
+    for (int i = 0; i < G_command_stats.n_client_commands; i++) {
+        if (G_command_stats.client_commands[i].code == client_command) {
+            ++G_command_stats.client_commands[i].n_interruptions;
+            return;
+        }
+    }
+    if (G_command_stats.n_client_commands < COMMAND_STATS_MAX_CLIENT_COMMANDS) {
+        int i = G_command_stats.n_client_commands++;
+        G_command_stats.client_commands[i].code = client_command;
+        G_command_stats.client_commands[i].n_interruptions = 1;
+    }
+}
+
+void command_stats_handle_command(const command_t *cmd) {
+    if ((cmd->p1 != COMMAND_STATS_P1_READ && cmd->p1 != COMMAND_STATS_P1_READ_AND_RESET) ||
+        cmd->p2 != 0) {
+        io_send_sw(SW_WRONG_P1P2);
+        return;
+    }
+
+    // Response: <bytes_in : 4> <bytes_out : 4> <merkle_combine_hashes : 4> <bip32_derivations : 4>
+    //           <n_client_commands : 1>, then for each client command
+    //           <client_command_code : 1> <n_interruptions : 4>
+    uint8_t response[4 * 4 + 1 + COMMAND_STATS_MAX_CLIENT_COMMANDS * (1 + 4)];
+    buffer_t out = buffer_create(response, sizeof(response));
+    buffer_write_u32(&out, G_command_stats.bytes_in, BE);
+    buffer_write_u32(&out, G_command_stats.bytes_out, BE);
+    buffer_write_u32(&out, G_command_stats.merkle_combine_hashes, BE);
+    buffer_write_u32(&out, G_command_stats.bip32_derivations, BE);
+    buffer_write_u8(&out, G_command_stats.n_client_commands);
+    for (int i = 0; i < G_command_stats.n_client_commands; i++) {
+        buffer_write_u8(&out, G_command_stats.client_commands[i].code);
+        buffer_write_u32(&out, G_command_stats.client_commands[i].n_interruptions, BE);
+    }
+
+    if (cmd->p1 == COMMAND_STATS_P1_READ_AND_RESET) {
+        command_stats_reset();
+    }
+
+    io_send_response(response, out.offset, SW_OK);
+}
+
+#endif
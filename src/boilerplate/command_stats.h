@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "apdu_parser.h"
+
+/**
+ * Counters of the protocol traffic and of the expensive operations of the last command, only
+ * compiled in builds with HAVE_COMMAND_STATS (make COMMAND_STATS=1).
+ *
+ * The counters are reset when a new command starts (that is, any APDU other than the framework
+ * commands), and can be read with the INS_GET_COMMAND_STATS framework command.
+ */
+
+// Maximum number of distinct client commands whose interruptions are counted
+#define COMMAND_STATS_MAX_CLIENT_COMMANDS 8
+
+// P1 values of INS_GET_COMMAND_STATS
+#define COMMAND_STATS_P1_READ           0x00  // read the counters
+#define COMMAND_STATS_P1_READ_AND_RESET 0x01  // read the counters, then reset them
+
+#ifdef HAVE_COMMAND_STATS
+
+typedef struct {
+    uint32_t bytes_in;               // bytes of all the APDUs received, including the headers
+    uint32_t bytes_out;              // bytes of all the responses sent, including the status words
+    uint32_t merkle_combine_hashes;  // number of calls to merkle_combine_hashes
+    uint32_t bip32_derivations;      // number of BIP32 child key derivations
+    uint8_t n_client_commands;
+    struct {
+        uint8_t code;              // client command code
+        uint32_t n_interruptions;  // number of interruptions with this client command
+    } client_commands[COMMAND_STATS_MAX_CLIENT_COMMANDS];
+} command_stats_t;
+
+extern command_stats_t G_command_stats;
+
+/**
+ * Resets all the counters.
+ */
+void command_stats_reset(void);
+
+/**
+ * Counts an interruption whose response starts with the given client command code.
+ */
+void command_stats_add_interruption(uint8_t client_command);
+
+/**
+ * Processes an INS_GET_COMMAND_STATS command, and sends the response.
+ */
+void command_stats_handle_command(const command_t *cmd);
+
+#define COMMAND_STATS_RESET()                      command_stats_reset()
+#define COMMAND_STATS_ADD(counter, n)              (G_command_stats.counter += (n))
+#define COMMAND_STATS_ADD_INTERRUPTION(client_cmd) command_stats_add_interruption(client_cmd)
+#else
+#define COMMAND_STATS_RESET()
+#define COMMAND_STATS_ADD(counter, n)
+#define COMMAND_STATS_ADD_INTERRUPTION(client_cmd)
+#endif
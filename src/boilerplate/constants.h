@@ -9,3 +9,15 @@
  * Framework instruction to continue execution after an interruption.
  */
 #define INS_CONTINUE 0x01
+
+/**
+ * Framework instruction to read or reset the profiling statistics (only if HAVE_PROFILING is
+ * defined).
+ */
+#define INS_GET_PROFILE_STATS 0x02
+
+/**
+ * Framework instruction to read the counters of the last command (only if HAVE_COMMAND_STATS is
+ * defined).
+ */
+#define INS_GET_COMMAND_STATS 0x03
@@ -19,9 +19,11 @@
 #include <stdbool.h>
 
 #include "dispatcher.h"
+#include "command_stats.h"
 #include "constants.h"
 #include "globals.h"
 #include "io.h"
+#include "profile.h"
 #include "sw.h"
 
 #include "common/buffer.h"
@@ -33,9 +35,13 @@ extern bool G_was_processing_screen_shown;
 // Private state that is not made accessible from the dispatcher context
 struct {
     void (*termination_cb)(void);
+    machine_context_t *top_context;
+    size_t top_context_size;
     bool paused;
     uint16_t sw;
     bool had_ux_flow;  // set to true if there was any UX flow during the APDU processing
+    // free part of the response, if requested with get_response_buffer; ptr is NULL otherwise
+    buffer_t response_buffer;
 } G_dispatcher_state;
 
 static void dispatcher_loop();
@@ -44,16 +50,49 @@ static void next(command_processor_t next_processor) {
     G_dispatcher_context.machine_context_ptr->next_processor = next_processor;
 }
 
+// Makes the response buffer cover the free part of the response, except the status word
+static void reset_response_buffer() {
+    size_t free_len =
+        G_output_len < IO_APDU_BUFFER_SIZE - 2 ? IO_APDU_BUFFER_SIZE - 2 - G_output_len : 0;
+    G_dispatcher_state.response_buffer = buffer_create(G_io_apdu_buffer + G_output_len, free_len);
+}
+
+// Adds to the response the bytes written in the response buffer, if any
+static void commit_response_buffer() {
+    G_output_len += G_dispatcher_state.response_buffer.offset;
+    G_dispatcher_state.response_buffer.offset = 0;
+}
+
 static void add_to_response(const void *rdata, size_t rdata_len) {
-    io_add_to_response(rdata, rdata_len);
+    if (G_dispatcher_state.response_buffer.ptr != NULL) {
+        commit_response_buffer();
+        io_add_to_response(rdata, rdata_len);
+        reset_response_buffer();
+    } else {
+        io_add_to_response(rdata, rdata_len);
+    }
+}
+
+static buffer_t *get_response_buffer() {
+    // the response overwrites the incoming APDU, that must not be read anymore
+    G_dispatcher_context.read_buffer = buffer_create(NULL, 0);
+
+    if (G_dispatcher_state.response_buffer.ptr == NULL) {
+        reset_response_buffer();
+    }
+    return &G_dispatcher_state.response_buffer;
 }
 
 static void finalize_response(uint16_t sw) {
+    commit_response_buffer();
+    G_dispatcher_state.response_buffer = buffer_create(NULL, 0);
+
     G_dispatcher_state.sw = sw;
     io_finalize_response(sw);
 }
 
 static void send_response() {
+    COMMAND_STATS_ADD(bytes_out, G_output_len);
     io_confirm_response();
 }
 
@@ -96,11 +135,22 @@ static int process_interruption(dispatcher_context_t *dc) {
 
     io_start_interruption_timeout();
 
+    // the first byte of the response is the code of the client command
+    PROFILE_INTERRUPTION_START(G_io_apdu_buffer[0]);
+    COMMAND_STATS_ADD_INTERRUPTION(G_io_apdu_buffer[0]);
+    COMMAND_STATS_ADD(bytes_out, G_output_len);
+
     // Receive command bytes in G_io_apdu_buffer
-    if ((input_len = io_exchange(CHANNEL_APDU, G_output_len)) < 0) {
+    input_len = io_exchange(CHANNEL_APDU, G_output_len);
+
+    PROFILE_INTERRUPTION_END();
+
+    if (input_len < 0) {
         return -1;
     }
 
+    COMMAND_STATS_ADD(bytes_in, input_len);
+
     io_clear_interruption_timeout();
 
     G_output_len = 0;
@@ -147,17 +197,36 @@ void apdu_dispatcher(command_descriptor_t const cmd_descriptors[],
                      size_t top_context_size,
                      void (*termination_cb)(void),
                      const command_t *cmd) {
+    // the debug commands do not affect the state of the dispatcher, nor the statistics
+#ifdef HAVE_PROFILING
+    if (cmd->cla == CLA_FRAMEWORK && cmd->ins == INS_GET_PROFILE_STATS) {
+        profile_handle_command(cmd);
+        return;
+    }
+#endif
+
+#ifdef HAVE_COMMAND_STATS
+    if (cmd->cla == CLA_FRAMEWORK && cmd->ins == INS_GET_COMMAND_STATS) {
+        command_stats_handle_command(cmd);
+        return;
+    }
+#endif
+
     // TODO: decide what to do if a command is sent while something was still running
     // currently: wiping everything
 
     G_dispatcher_state.had_ux_flow = false;
 
     G_dispatcher_state.termination_cb = termination_cb;
+    G_dispatcher_state.top_context = top_context;
+    G_dispatcher_state.top_context_size = top_context_size;
     G_dispatcher_state.paused = false;
     G_dispatcher_state.sw = 0;
+    G_dispatcher_state.response_buffer = buffer_create(NULL, 0);
 
     G_dispatcher_context.next = next;
     G_dispatcher_context.add_to_response = add_to_response;
+    G_dispatcher_context.get_response_buffer = get_response_buffer;
     G_dispatcher_context.finalize_response = finalize_response;
     G_dispatcher_context.send_response = send_response;
     G_dispatcher_context.pause = pause;
@@ -179,12 +248,17 @@ void apdu_dispatcher(command_descriptor_t const cmd_descriptors[],
             io_send_sw(SW_BAD_STATE);  // received INS_CONTINUE, but no command was interrupted.
             return;
         }
+
+        COMMAND_STATS_ADD(bytes_in, 5 + cmd->lc);  // header and data of the APDU
     } else {
         // If a previous command was interrupted but any command other than INS_CONTINUE is
         // received, the interrupted command is discarded.
 
         G_dispatcher_context.machine_context_ptr = top_context;
 
+        COMMAND_STATS_RESET();
+        COMMAND_STATS_ADD(bytes_in, 5 + cmd->lc);  // header and data of the APDU
+
         // Safety measure: reset to 0 the entire context before starting.
         explicit_bzero(top_context, top_context_size);
 
@@ -208,8 +282,13 @@ void apdu_dispatcher(command_descriptor_t const cmd_descriptors[],
             return;
         }
 
+        G_dispatcher_context.p1 = cmd->p1;
+        G_dispatcher_context.p2 = cmd->p2;
+
         io_start_processing_timeout();
+        PROFILE_PROCESSOR_START(handler);
         handler(&G_dispatcher_context);
+        PROFILE_PROCESSOR_END();
     }
 
     dispatcher_loop();
@@ -237,7 +316,9 @@ static void dispatcher_loop() {
             command_processor_t proc = G_dispatcher_context.machine_context_ptr->next_processor;
             G_dispatcher_context.machine_context_ptr->next_processor = NULL;
 
+            PROFILE_PROCESSOR_START(proc);
             proc(&G_dispatcher_context);
+            PROFILE_PROCESSOR_END();
 
             // if an interruption is sent, should exit the loop and persist the context for the next
             // call in that case, there MUST be a next_processor
@@ -266,6 +347,9 @@ static void dispatcher_loop() {
         io_send_sw(SW_BAD_STATE);
     }
 
+    // The command is over: wipe its state, that might contain sensitive data
+    explicit_bzero(G_dispatcher_state.top_context, G_dispatcher_state.top_context_size);
+
     // We call the termination callback if given, but only if the UX is "dirty", that is either
     // - there was some kind of UX flow with user interaction;
     // - background processing took long enough that the "Processing..." screen was shown.
@@ -48,11 +48,14 @@ static inline dispatcher_callback_descriptor_t make_callback(void *state,
 struct dispatcher_context_s {
     machine_context_t *machine_context_ptr;
     buffer_t read_buffer;
+    uint8_t p1;  // P1 of the APDU that started the current command
+    uint8_t p2;  // P2 of the APDU that started the current command
 
     void (*pause)();
     void (*run)();
     void (*next)(command_processor_t next_processor);
     void (*add_to_response)(const void *rdata, size_t rdata_len);
+    buffer_t *(*get_response_buffer)(void);
     void (*finalize_response)(uint16_t sw);
     void (*send_response)(void);
     void (*start_flow)(command_processor_t first_processor,
@@ -83,15 +86,13 @@ static inline void SEND_RESPONSE(struct dispatcher_context_s *dc,
     dc->send_response();
 }
 
-// TODO: instead of exposing a method like send_response, it might be more efficient to expose the
-// response buffer,
-//       so that one could use the buffer_write_* methods directly.
-//       On the other hand, buth the read_buffer and the write buffer would point to the same shared
-//       global space (part of G_io_apdu_buffer). Therefore, one would have to make sure that no
-//       read happens after writes happen, and it would probably be better if the dispatcher
-//       enforces this, by making it impossible to accidentally read the read_buffer after writes
-//       happened. One way could be have a function get_output_buffer() in the dispatcher context,
-//       that returns the output buffer but it first zeroes the read_buffer.
+// The response can also be written in place with the buffer_write_* functions, using the buffer
+// returned by get_response_buffer(). It covers the part of G_io_apdu_buffer after the response
+// built so far, except the 2 bytes reserved for the status word; the bytes written in it become
+// part of the response, and add_to_response() appends after them. The buffer is valid until
+// finalize_response() is called, and a new one must be requested for each response.
+// Since the response shares the memory of the incoming APDU, get_response_buffer() invalidates
+// read_buffer: all the data needed from the client's message must be read before writing starts.
 
 /**
  * Describes a command that can be processed by the dispatcher.
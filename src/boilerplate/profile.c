@@ -0,0 +1,183 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#ifdef HAVE_PROFILING
+
+#include <stdint.h>
+#include <string.h>
+
+#include "profile.h"
+#include "io.h"
+#include "sw.h"
+
+#include "common/buffer.h"
+
+extern uint16_t G_ticks;
+
+typedef struct {
+    uint32_t key;           // address of the processor, or client command code
+    uint32_t n_calls;       // number of calls
+    uint32_t device_ticks;  // ticks spent on the device
+    uint32_t host_ticks;    // ticks spent waiting for the client
+} profile_entry_t;
+
+// Each entry of the response is <key : 4> <n_calls : 4> <device_ticks : 4> <host_ticks : 4>
+#define PROFILE_ENTRY_SIZE               16
+#define PROFILE_MAX_ENTRIES_PER_RESPONSE 15
+
+struct {
+    profile_entry_t processors[PROFILE_MAX_PROCESSORS];
+    profile_entry_t client_commands[PROFILE_MAX_CLIENT_COMMANDS];
+    uint8_t n_processors;
+    uint8_t n_client_commands;
+
+    profile_entry_t *cur_processor;       // NULL if no processor is running
+    profile_entry_t *cur_client_command;  // last client command of the current processor, if any
+    uint16_t last_tick;                   // start of the interval that is not accounted yet
+} G_profile;
+
+// Returns the entry with the given key, adding it if not present; NULL if the table is full
+static profile_entry_t *get_entry(profile_entry_t entries[],
+                                  uint8_t *n_entries,
+                                  uint8_t max_entries,
+                                  uint32_t key) {
+    for (int i = 0; i < *n_entries; i++) {
+        if (entries[i].key == key) {
+            return &entries[i];
+        }
+    }
+    if (*n_entries == max_entries) {
+        return NULL;
+    }
+    profile_entry_t *entry = &entries[(*n_entries)++];
+    memset(entry, 0, sizeof(profile_entry_t));
+    entry->key = key;
+    return entry;
+}
+
+// Returns the number of ticks since the last call, and starts a new interval
+static uint16_t elapsed_ticks() {
+    uint16_t elapsed = G_ticks - G_profile.last_tick;
+    G_profile.last_tick = G_ticks;
+    return elapsed;
+}
+
+// Accounts the ticks since the last event as device time of the current processor and client
+// command
+static void account_device_ticks() {
+    uint16_t elapsed = elapsed_ticks();
+    if (G_profile.cur_processor != NULL) {
+        G_profile.cur_processor->device_ticks += elapsed;
+    }
+    if (G_profile.cur_client_command != NULL) {
+        G_profile.cur_client_command->device_ticks += elapsed;
+    }
+}
+
+void profile_processor_start(command_processor_t processor) {
+    // processors are identified by their offset from apdu_dispatcher, that does not depend on the
+    // address where the app is loaded
+    uint32_t key = (uint32_t) ((uintptr_t) processor - (uintptr_t) apdu_dispatcher);
+
+    G_profile.cur_processor =
+        get_entry(G_profile.processors, &G_profile.n_processors, PROFILE_MAX_PROCESSORS, key);
+    G_profile.cur_client_command = NULL;
+    if (G_profile.cur_processor != NULL) {
+        ++G_profile.cur_processor->n_calls;
+    }
+    G_profile.last_tick = G_ticks;
+}
+
+void profile_processor_end() {
+    account_device_ticks();
+    G_profile.cur_processor = NULL;
+    G_profile.cur_client_command = NULL;
+}
+
+void profile_interruption_start(uint8_t client_command) {
+    account_device_ticks();
+
+    G_profile.cur_client_command = get_entry(G_profile.client_commands,
+                                             &G_profile.n_client_commands,
+                                             PROFILE_MAX_CLIENT_COMMANDS,
+                                             client_command);
+    if (G_profile.cur_client_command != NULL) {
+        ++G_profile.cur_client_command->n_calls;
+    }
+}
+
+void profile_interruption_end() {
+    uint16_t elapsed = elapsed_ticks();
+    if (G_profile.cur_processor != NULL) {
+        G_profile.cur_processor->host_ticks += elapsed;
+    }
+    if (G_profile.cur_client_command != NULL) {
+        G_profile.cur_client_command->host_ticks += elapsed;
+    }
+}
+
+void profile_handle_command(const command_t *cmd) {
+    const profile_entry_t *entries;
+    uint8_t n_entries;
+
+    switch (cmd->p1) {
+        case PROFILE_P1_PROCESSORS:
+            entries = G_profile.processors;
+            n_entries = G_profile.n_processors;
+            break;
+        case PROFILE_P1_CLIENT_COMMANDS:
+            entries = G_profile.client_commands;
+            n_entries = G_profile.n_client_commands;
+            break;
+        case PROFILE_P1_RESET:
+            if (cmd->p2 != 0) {
+                io_send_sw(SW_WRONG_P1P2);
+                return;
+            }
+            explicit_bzero(&G_profile, sizeof(G_profile));
+            io_send_sw(SW_OK);
+            return;
+        default:
+            io_send_sw(SW_WRONG_P1P2);
+            return;
+    }
+
+    // P2 is the index of the first entry to return
+    if (cmd->p2 > n_entries) {
+        io_send_sw(SW_WRONG_P1P2);
+        return;
+    }
+    uint8_t n_returned = n_entries - cmd->p2;
+    if (n_returned > PROFILE_MAX_ENTRIES_PER_RESPONSE) {
+        n_returned = PROFILE_MAX_ENTRIES_PER_RESPONSE;
+    }
+
+    // Response: <n_entries : 1> <n_returned : 1> followed by n_returned entries
+    uint8_t response[2 + PROFILE_MAX_ENTRIES_PER_RESPONSE * PROFILE_ENTRY_SIZE];
+    buffer_t out = buffer_create(response, sizeof(response));
+    buffer_write_u8(&out, n_entries);
+    buffer_write_u8(&out, n_returned);
+    for (int i = cmd->p2; i < cmd->p2 + n_returned; i++) {
+        buffer_write_u32(&out, entries[i].key, BE);
+        buffer_write_u32(&out, entries[i].n_calls, BE);
+        buffer_write_u32(&out, entries[i].device_ticks, BE);
+        buffer_write_u32(&out, entries[i].host_ticks, BE);
+    }
+    io_send_response(response, out.offset, SW_OK);
+}
+
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "apdu_parser.h"
+#include "dispatcher.h"
+
+/**
+ * Profiling of the dispatcher, only compiled in builds with HAVE_PROFILING (make PROFILE=1).
+ *
+ * For each command processor (including the command handlers), and for each type of client
+ * command, it records the number of calls, the ticks spent on the device and the ticks spent
+ * waiting for the client's response to an interruption. For a client command, the device ticks are
+ * the ones spent processing its response, until the next interruption or the end of the processor.
+ * Ticks are the ones counted in G_ticks, that is, every 100 ms; therefore, the statistics are only
+ * meaningful in aggregate, over many calls.
+ *
+ * The statistics are accumulated across commands, and can be read or reset with the
+ * INS_GET_PROFILE_STATS framework command.
+ */
+
+#ifdef TARGET_NANOS
+#define PROFILE_MAX_PROCESSORS 16
+#else
+#define PROFILE_MAX_PROCESSORS 48
+#endif
+#define PROFILE_MAX_CLIENT_COMMANDS 8
+
+// P1 values of INS_GET_PROFILE_STATS
+#define PROFILE_P1_PROCESSORS      0x00  // read the statistics of the processors
+#define PROFILE_P1_CLIENT_COMMANDS 0x01  // read the statistics of the client commands
+#define PROFILE_P1_RESET           0x02  // reset all the statistics
+
+#ifdef HAVE_PROFILING
+
+/**
+ * Starts accounting the time to the given processor; called before each processor or handler runs.
+ */
+void profile_processor_start(command_processor_t processor);
+
+/**
+ * Stops accounting the time to the current processor; called when it returns.
+ */
+void profile_processor_end(void);
+
+/**
+ * Called right before sending an interruption whose response starts with the given client command
+ * code; the time until profile_interruption_end() is accounted as time spent waiting the host.
+ */
+void profile_interruption_start(uint8_t client_command);
+
+/**
+ * Called when the client's response to the current interruption is received.
+ */
+void profile_interruption_end(void);
+
+/**
+ * Processes an INS_GET_PROFILE_STATS command, and sends the response.
+ */
+void profile_handle_command(const command_t *cmd);
+
+#define PROFILE_PROCESSOR_START(processor)         profile_processor_start(processor)
+#define PROFILE_PROCESSOR_END()                    profile_processor_end()
+#define PROFILE_INTERRUPTION_START(client_command) profile_interruption_start(client_command)
+#define PROFILE_INTERRUPTION_END()                 profile_interruption_end()
+#else
+#define PROFILE_PROCESSOR_START(processor)
+#define PROFILE_PROCESSOR_END()
+#define PROFILE_INTERRUPTION_START(client_command)
+#define PROFILE_INTERRUPTION_END()
+#endif
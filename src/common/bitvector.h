@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of bytes needed to store a bitvector of n bits
+#define BITVECTOR_REAL_SIZE(n) (((n) + 7) / 8)
+
+/**
+ * Sets the i-th bit of the bitvector to the given value.
+ */
+static inline void bitvector_set(uint8_t *vector, size_t i, bool value) {
+    uint8_t mask = (uint8_t) (1 << (i % 8));
+    if (value) {
+        vector[i / 8] |= mask;
+    } else {
+        vector[i / 8] &= (uint8_t) ~mask;
+    }
+}
+
+/**
+ * Returns the value of the i-th bit of the bitvector.
+ */
+static inline bool bitvector_get(const uint8_t *vector, size_t i) {
+    return (vector[i / 8] >> (i % 8)) & 1;
+}
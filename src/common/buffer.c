@@ -225,6 +225,17 @@ bool buffer_write_u64(buffer_t *buffer, uint64_t value, endianness_t endianness)
     return true;
 }
 
+bool buffer_write_varint(buffer_t *buffer, uint64_t value) {
+    if (!buffer_can_read(buffer, varint_size(value))) {
+        return false;
+    }
+
+    int length = varint_write(buffer->ptr, buffer->offset, value);
+    buffer_seek_cur(buffer, (size_t) length);
+
+    return true;
+}
+
 bool buffer_write_bytes(buffer_t *buffer, const uint8_t *data, size_t n) {
     if (!buffer_can_read(buffer, n)) {
         return false;
@@ -240,7 +251,7 @@ void *buffer_alloc(buffer_t *buffer, size_t size, bool aligned) {
     size_t padding_size = 0;
 
     if (aligned) {
-        uint32_t d = (uint32_t) (buffer->ptr + buffer->offset) % 4;
+        uint32_t d = (uint32_t) ((uintptr_t) (buffer->ptr + buffer->offset) % 4);
         if (d != 0) {
             padding_size = 4 - d;
         }
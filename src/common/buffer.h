@@ -237,6 +237,19 @@ bool buffer_write_u32(buffer_t *buffer, uint32_t value, endianness_t endianness)
  */
 bool buffer_write_u64(buffer_t *buffer, uint64_t value, endianness_t endianness);
 
+/**
+ * Write a uint64_t into the buffer as a Bitcoin-style varint.
+ *
+ * @param[in,out]  buffer
+ *   Pointer to output buffer struct.
+ * @param[out]     value
+ *   Value to be written.
+ *
+ * @return true if success, false if not enough space left in the buffer.
+ *
+ */
+bool buffer_write_varint(buffer_t *buffer, uint64_t value);
+
 /**
  * Write a number of bytes to a buffer.
  *
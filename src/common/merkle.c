@@ -21,6 +21,7 @@
 
 #include "buffer.h"
 #include "../crypto.h"
+#include "../boilerplate/command_stats.h"
 
 #include "merkle.h"
 
@@ -59,6 +60,8 @@ void merkle_combine_hashes(const uint8_t left[static 32],
                            uint8_t out[static 32]) {
     PRINT_STACK_POINTER();
 
+    COMMAND_STATS_ADD(merkle_combine_hashes, 1);
+
     cx_sha256_init_no_throw(&G_cx.sha256);
 
     uint8_t prefix = 0x01;
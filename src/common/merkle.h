@@ -70,7 +70,7 @@ static inline uint8_t ceil_lg(uint32_t n) {
 
 // Returns the ith member of the directions array for the leaf with the given index in a Merkle tree
 // of the given size. Returns -1 on error.
-// TODO: make this O(log n), or possibly O(1). Currently O(log^2 n).
+// This is O(log^2 n); use merkle_get_leaf_path to compute all the directions in O(log n).
 //
 // inlined to save on stack depth (only used once anyway, so no impact on code size)
 static inline int merkle_get_ith_direction(size_t size, size_t index, size_t i) {
@@ -107,6 +107,38 @@ static inline int merkle_get_ith_direction(size_t size, size_t index, size_t i)
     return -1;
 }
 
+// Computes the directions of the path from the root to the leaf with the given index in a Merkle
+// tree of the given size, as a bitmask (bit d is 1 iff the path goes to the right child at depth
+// d). Returns the depth of the leaf, or -1 if the index is not valid.
+// Runs in O(log n).
+static inline int merkle_get_leaf_path(uint32_t size, uint32_t index, uint32_t *directions) {
+    if (index >= size) {
+        return -1;
+    }
+
+    // number of leaves of the left subtree of the current node, that is, the largest power of 2
+    // smaller than size. As size only decreases, it is found by halving the previous value.
+    uint32_t mask = (uint32_t) 1 << 31;
+
+    int depth = 0;
+    *directions = 0;
+    while (size > 1) {
+        while (mask >= size) {
+            mask >>= 1;
+        }
+
+        if (index >= mask) {
+            *directions |= (uint32_t) 1 << depth;
+            size -= mask;
+            index -= mask;
+        } else {
+            size = mask;
+        }
+        ++depth;
+    }
+    return depth;
+}
+
 /**
  * Represents the Merkleized version of a key-value map, holding the number of elements, the root of
  * the Merkle tree of the sorted list of keys, and the root of the Merkle tree of the values (sorted
@@ -31,35 +31,66 @@ bool dbuffer_read_bytes(buffer_t *buffers[2], uint8_t *out, size_t n) {
     return true;
 }
 
+const uint8_t *dbuffer_read_ptr(buffer_t *buffers[2], uint8_t *tmp, size_t n) {
+    for (int i = 0; i < 2; i++) {
+        size_t length = buffers[i]->size - buffers[i]->offset;
+        if (length >= n) {
+            // all the data is in this buffer, no need to copy
+            const uint8_t *ptr = buffers[i]->ptr + buffers[i]->offset;
+            buffer_seek_cur(buffers[i], n);
+            return ptr;
+        } else if (length > 0) {
+            break;  // the data straddles the two buffers
+        }
+    }
+
+    if (!dbuffer_read_bytes(buffers, tmp, n)) {
+        return NULL;
+    }
+    return tmp;
+}
+
+size_t dbuffer_read_available(buffer_t *buffers[2], size_t max_n, const uint8_t **out) {
+    buffer_t *buf = buffer_can_read(buffers[0], 1) ? buffers[0] : buffers[1];
+
+    size_t n = buf->size - buf->offset;
+    if (n > max_n) {
+        n = max_n;
+    }
+    *out = buf->ptr + buf->offset;
+    buffer_seek_cur(buf, n);
+    return n;
+}
+
 bool dbuffer_read_u8(buffer_t *buffers[2], uint8_t *out) {
     return dbuffer_read_bytes(buffers, out, 1);
 }
 
 bool dbuffer_read_u16(buffer_t *buffers[2], uint16_t *out, endianness_t endianness) {
-    if (!dbuffer_can_read(buffers, 2)) {
+    uint8_t tmp[2];
+    const uint8_t *data = dbuffer_read_ptr(buffers, tmp, 2);
+    if (data == NULL) {
         return false;
     }
 
-    uint8_t tmp[2];
-    dbuffer_read_bytes(buffers, tmp, 2);
     if (endianness == BE)
-        *out = read_u16_be(tmp, 0);
+        *out = read_u16_be(data, 0);
     else
-        *out = read_u16_le(tmp, 0);
+        *out = read_u16_le(data, 0);
     return true;
 }
 
 bool dbuffer_read_u32(buffer_t *buffers[2], uint32_t *out, endianness_t endianness) {
-    if (!dbuffer_can_read(buffers, 4)) {
+    uint8_t tmp[4];
+    const uint8_t *data = dbuffer_read_ptr(buffers, tmp, 4);
+    if (data == NULL) {
         return false;
     }
 
-    uint8_t tmp[4];
-    dbuffer_read_bytes(buffers, tmp, 4);
     if (endianness == BE)
-        *out = read_u32_be(tmp, 0);
+        *out = read_u32_be(data, 0);
     else
-        *out = read_u32_le(tmp, 0);
+        *out = read_u32_le(data, 0);
     return true;
 }
 
@@ -87,22 +118,26 @@ bool dbuffer_read_varint(buffer_t *buffers[2], uint64_t *out) {
             break;
     }
 
-    if (!dbuffer_can_read(buffers, 1 + len)) {
+    uint8_t tmp[1 + 8];
+    const uint8_t *data = dbuffer_read_ptr(buffers, tmp, 1 + len);
+    if (data == NULL) {
         return false;
     }
 
-    dbuffer_read_u8(buffers, &first_byte);  // redundant, just to skip 1 byte
-
-    if (first_byte <= 0xfc) {
-        *out = first_byte;
-        return true;
+    switch (len) {
+        case 2:
+            *out = read_u16_le(data, 1);
+            break;
+        case 4:
+            *out = read_u32_le(data, 1);
+            break;
+        case 8:
+            *out = read_u64_le(data, 1);
+            break;
+        default:
+            *out = first_byte;
+            break;
     }
-
-    uint8_t data[8] = {0};
-    dbuffer_read_bytes(buffers, data, len);
-
-    // Since data was zeroed, parsing the entire array as a little-endian works for any size
-    *out = read_u64_le(data, 0);
     return true;
 }
 
@@ -39,6 +39,27 @@ bool dbuffer_can_read(buffer_t *buffers[2], size_t n);
  */
 bool dbuffer_read_bytes(buffer_t *buffers[2], uint8_t *out, size_t n);
 
+/**
+ * Reads the next n bytes from the concatenation of the two buffers, without copying them if
+ * possible. If the n bytes are entirely contained in one of the buffers, the returned pointer
+ * points directly inside that buffer; otherwise (that is, the bytes straddle the boundary between
+ * the two buffers), they are copied in tmp, that must have room for at least n bytes, and tmp is
+ * returned.
+ *
+ * @return a pointer to the n bytes, or NULL if less than n bytes are available, in which case the
+ * buffers are not modified.
+ */
+const uint8_t *dbuffer_read_ptr(buffer_t *buffers[2], uint8_t *tmp, size_t n);
+
+/**
+ * Reads at most max_n bytes from the first of the two buffers that is not exhausted, without
+ * copying them; *out is set to point directly inside that buffer. This is useful to process data
+ * of arbitrary length (e.g.: to hash it) in the largest possible contiguous pieces.
+ *
+ * @return the number of bytes read, that is 0 only if both buffers are exhausted or max_n is 0.
+ */
+size_t dbuffer_read_available(buffer_t *buffers[2], size_t max_n, const uint8_t **out);
+
 /**
  * TODO: docs.
  */
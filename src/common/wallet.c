@@ -16,28 +16,26 @@
 #define PIC(x) (x)
 #endif
 
-/*
-Currently supported policies for singlesig:
-
-- pkh(key/**) where `key` follows `BIP44`       (legacy)
-- wpkh(key/**) where `key` follows `BIP 84`     (native segwit)
-- sh(wpkh(key/**)) where `key` follows `BIP 49` (nested segwit)
-- tr(key/**) where `key` follows `BIP 86`       (single-key p2tr)
-
-Currently supported wallet policies for multisig:
-
-   LEGACY
-  sh(multi(...)))
-  sh(sortedmulti(...)))
-
-   NATIVE SEGWIT
-  wsh(multi(...))
-  wsh(sortedmulti(...))
-
-   WRAPPED SEGWIT
-  sh(wsh(multi(...)))
-  sh(wsh(sortedmulti(...)))
-*/
+// Currently supported policies for singlesig:
+//
+// - pkh(key/**) where `key` follows `BIP44`       (legacy)
+// - wpkh(key/**) where `key` follows `BIP 84`     (native segwit)
+// - sh(wpkh(key/**)) where `key` follows `BIP 49` (nested segwit)
+// - tr(key/**) where `key` follows `BIP 86`       (single-key p2tr)
+//
+// Currently supported wallet policies for multisig:
+//
+//    LEGACY
+//   sh(multi(...)))
+//   sh(sortedmulti(...)))
+//
+//    NATIVE SEGWIT
+//   wsh(multi(...))
+//   wsh(sortedmulti(...))
+//
+//    WRAPPED SEGWIT
+//   sh(wsh(multi(...)))
+//   sh(wsh(sortedmulti(...)))
 
 // TODO: add unit tests to this module
 
@@ -161,7 +159,7 @@ static int parse_token(buffer_t *buffer) {
 
     for (unsigned int i = 0; i < sizeof(KNOWN_TOKENS) / sizeof(KNOWN_TOKENS[0]); i++) {
         if (strncmp((const char *) PIC(KNOWN_TOKENS[i].name), word, MAX_TOKEN_LENGTH) == 0) {
-            return (int) PIC(KNOWN_TOKENS[i].type);
+            return KNOWN_TOKENS[i].type;
         }
     }
 
@@ -215,7 +213,7 @@ static int parse_unsigned_decimal(buffer_t *buffer, size_t *out) {
 // Reads a derivation step expressed in decimal, with the symbol ' to mark if hardened (h is not
 // supported) Returns 0 on success, -1 on error.
 static int buffer_read_derivation_step(buffer_t *buffer, uint32_t *out) {
-    uint32_t der_step;
+    size_t der_step;
     if (parse_unsigned_decimal(buffer, &der_step) == -1 || der_step >= BIP32_FIRST_HARDENED_CHILD) {
         PRINTF("Failed reading derivation step\n");
         return -1;
@@ -10,6 +10,13 @@
  */
 #define CLA_APP 0xE1
 
+/**
+ * Flag in the P2 of the APDUs with CLA_APP: if set, the client supports the client commands and
+ * the request formats that were added in version 2.1.0 of the app (see handler/client_commands.h).
+ * Otherwise, the app only uses the client commands of version 2.0.
+ */
+#define P2_CLIENT_EXTENDED_COMMANDS 0x80
+
 /**
  * Length of APPNAME variable in the Makefile.
  */
@@ -32,6 +32,8 @@
 
 #include "crypto.h"
 
+#include "boilerplate/command_stats.h"
+
 #include "cx_ram.h"
 #include "lcx_ripemd160.h"
 #include "cx_ripemd160.h"
@@ -91,6 +93,8 @@ int crypto_derive_private_key(cx_ecfp_private_key_t *private_key,
                               uint8_t bip32_path_len) {
     uint8_t raw_private_key[32] = {0};
 
+    COMMAND_STATS_ADD(bip32_derivations, bip32_path_len);
+
     int ret = 0;
     BEGIN_TRY {
         TRY {
@@ -133,6 +137,8 @@ int bip32_CKDpub(const serialized_extended_pubkey_t *parent,
         return -2;  // maximum derivation depth reached
     }
 
+    COMMAND_STATS_ADD(bip32_derivations, 1);
+
     uint8_t I[64];
 
     {  // make sure that heavy memory allocations are freed as soon as possible
@@ -188,6 +194,65 @@ int bip32_CKDpub(const serialized_extended_pubkey_t *parent,
     return 0;
 }
 
+int crypto_derive_child_private_key(const uint8_t parent_privkey[static 32],
+                                    const uint8_t parent_chain_code[static 32],
+                                    uint32_t index,
+                                    uint8_t child_privkey[static 32],
+                                    uint8_t child_chain_code[static 32]) {
+    PRINT_STACK_POINTER();
+
+    if (index >= BIP32_FIRST_HARDENED_CHILD) {
+        return -1;  // can only derive unhardened children
+    }
+
+    COMMAND_STATS_ADD(bip32_derivations, 1);
+
+    cx_ecfp_private_key_t private_key = {0};
+    cx_ecfp_public_key_t public_key;
+    uint8_t I[64];
+
+    int ret = 0;
+    BEGIN_TRY {
+        TRY {
+            uint8_t tmp[33 + 4];
+
+            // the child is derived from the parent's compressed pubkey, like in bip32_CKDpub
+            cx_ecfp_init_private_key(CX_CURVE_256K1, parent_privkey, 32, &private_key);
+            cx_ecfp_generate_pair(CX_CURVE_256K1, &public_key, &private_key, 1);
+            crypto_get_compressed_pubkey(public_key.W, tmp);
+            write_u32_be(tmp, 33, index);
+
+            cx_hmac_sha512(parent_chain_code, 32, tmp, sizeof(tmp), I, 64);
+
+            uint8_t *I_L = &I[0];
+            uint8_t *I_R = &I[32];
+
+            // fail if I_L is not smaller than the group order n, or if the child key is 0; the
+            // probability is < 1/2^127
+            if (cx_math_cmp(I_L, secp256k1_n, 32) >= 0) {
+                ret = -1;
+            } else {
+                cx_math_addm(child_privkey, parent_privkey, I_L, secp256k1_n, 32);
+                memcpy(child_chain_code, I_R, 32);
+
+                if (cx_math_is_zero(child_privkey, 32)) {
+                    ret = -1;
+                }
+            }
+        }
+        CATCH_ALL {
+            ret = -1;
+        }
+        FINALLY {
+            explicit_bzero(&private_key, sizeof(private_key));
+            explicit_bzero(I, sizeof(I));
+        }
+    }
+    END_TRY;
+
+    return ret;
+}
+
 /** Missing in the SDK, we implement it using the cxram section. */
 static size_t cx_hash_ripemd160(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len) {
     PRINT_STACK_POINTER();
@@ -206,7 +271,7 @@ void crypto_ripemd160(const uint8_t *in, uint16_t inlen, uint8_t out[static 20])
     cx_hash_ripemd160(in, inlen, out, 20);
 }
 
-void crypto_hash160(const uint8_t *in, uint16_t inlen, uint8_t out[static 20]) {
+void crypto_hash160(const uint8_t *in, uint16_t inlen, uint8_t *out) {
     PRINT_STACK_POINTER();
 
     uint8_t buffer[32];
@@ -313,11 +378,88 @@ uint32_t crypto_get_key_fingerprint(const uint8_t pub_key[static 33]) {
     return read_u32_be(key_rip, 0);
 }
 
+// Cache of the master key fingerprint and of the most recently used extended pubkeys, as deriving
+// them from the seed is slow. It is kept for the whole lifetime of the app, except on NanoS, where
+// it is cleared whenever the app switches back from the legacy protocol, as it shares its memory
+// with the globals of the legacy app.
+typedef struct {
+    bool has_master_key_fingerprint;
+    uint32_t master_key_fingerprint;
+
+    size_t n_ext_pubkeys;    // number of valid entries in ext_pubkeys
+    size_t next_ext_pubkey;  // index of the entry that is replaced next, once all are valid
+    struct {
+        uint8_t bip32_path_len;
+        uint32_t bip32_path[MAX_BIP32_PATH_STEPS];
+        serialized_extended_pubkey_t ext_pubkey;  // the version is not used
+    } ext_pubkeys[N_CACHED_EXTENDED_PUBKEYS];
+} pubkeys_cache_t;
+
+#ifdef TARGET_NANOS
+// on NanoS only, we optimize the usage of the globals with a custom linker script
+static pubkeys_cache_t __attribute__((section(".new_globals"))) G_pubkeys_cache;
+#else
+static pubkeys_cache_t G_pubkeys_cache;
+#endif
+
+void crypto_pubkeys_cache_reset(void) {
+    explicit_bzero(&G_pubkeys_cache, sizeof(G_pubkeys_cache));
+}
+
+// Copies in out the cached extended pubkey at the given path, if present. Returns true on success.
+static bool get_cached_ext_pubkey(const uint32_t bip32_path[],
+                                  uint8_t bip32_path_len,
+                                  serialized_extended_pubkey_t *out) {
+    if (bip32_path_len > MAX_BIP32_PATH_STEPS ||
+        G_pubkeys_cache.n_ext_pubkeys > N_CACHED_EXTENDED_PUBKEYS) {
+        return false;
+    }
+
+    for (size_t i = 0; i < G_pubkeys_cache.n_ext_pubkeys; i++) {
+        if (G_pubkeys_cache.ext_pubkeys[i].bip32_path_len == bip32_path_len &&
+            memcmp(G_pubkeys_cache.ext_pubkeys[i].bip32_path,
+                   bip32_path,
+                   bip32_path_len * sizeof(bip32_path[0])) == 0) {
+            memcpy(out, &G_pubkeys_cache.ext_pubkeys[i].ext_pubkey, sizeof(*out));
+            return true;
+        }
+    }
+    return false;
+}
+
+// Adds an extended pubkey to the cache, replacing the oldest one if the cache is full
+static void add_cached_ext_pubkey(const uint32_t bip32_path[],
+                                  uint8_t bip32_path_len,
+                                  const serialized_extended_pubkey_t *ext_pubkey) {
+    if (bip32_path_len > MAX_BIP32_PATH_STEPS ||
+        G_pubkeys_cache.next_ext_pubkey >= N_CACHED_EXTENDED_PUBKEYS ||
+        G_pubkeys_cache.n_ext_pubkeys > N_CACHED_EXTENDED_PUBKEYS) {
+        return;
+    }
+
+    size_t i = G_pubkeys_cache.next_ext_pubkey;
+    G_pubkeys_cache.ext_pubkeys[i].bip32_path_len = bip32_path_len;
+    memcpy(G_pubkeys_cache.ext_pubkeys[i].bip32_path,
+           bip32_path,
+           bip32_path_len * sizeof(bip32_path[0]));
+    memcpy(&G_pubkeys_cache.ext_pubkeys[i].ext_pubkey, ext_pubkey, sizeof(*ext_pubkey));
+
+    G_pubkeys_cache.next_ext_pubkey = (i + 1) % N_CACHED_EXTENDED_PUBKEYS;
+    if (G_pubkeys_cache.n_ext_pubkeys < N_CACHED_EXTENDED_PUBKEYS) {
+        ++G_pubkeys_cache.n_ext_pubkeys;
+    }
+}
+
 uint32_t crypto_get_master_key_fingerprint() {
-    uint8_t master_pub_key[33];
-    uint32_t bip32_path[] = {};
-    crypto_get_compressed_pubkey_at_path(bip32_path, 0, master_pub_key, NULL);
-    return crypto_get_key_fingerprint(master_pub_key);
+    if (!G_pubkeys_cache.has_master_key_fingerprint) {
+        uint8_t master_pub_key[33];
+        uint32_t bip32_path[1] = {0};  // unused, as the path is empty
+        crypto_get_compressed_pubkey_at_path(bip32_path, 0, master_pub_key, NULL);
+
+        G_pubkeys_cache.master_key_fingerprint = crypto_get_key_fingerprint(master_pub_key);
+        G_pubkeys_cache.has_master_key_fingerprint = true;
+    }
+    return G_pubkeys_cache.master_key_fingerprint;
 }
 
 void crypto_derive_symmetric_key(const char *label, size_t label_len, uint8_t key[static 32]) {
@@ -346,20 +488,6 @@ int get_serialized_extended_pubkey_at_path(const uint32_t bip32_path[],
                                            uint8_t bip32_path_len,
                                            uint32_t bip32_pubkey_version,
                                            char out[static MAX_SERIALIZED_PUBKEY_LENGTH + 1]) {
-    // find parent key's fingerprint and child number
-    uint32_t parent_fingerprint = 0;
-    uint32_t child_number = 0;
-    if (bip32_path_len > 0) {
-        // here we reuse the storage for the parent keys that we will later use
-        // for the response, in order to save memory
-
-        uint8_t parent_pubkey[33];
-        crypto_get_compressed_pubkey_at_path(bip32_path, bip32_path_len - 1, parent_pubkey, NULL);
-
-        parent_fingerprint = crypto_get_key_fingerprint(parent_pubkey);
-        child_number = bip32_path[bip32_path_len - 1];
-    }
-
     struct {
         serialized_extended_pubkey_t ext_pubkey;
         uint8_t checksum[4];
@@ -367,15 +495,38 @@ int get_serialized_extended_pubkey_at_path(const uint32_t bip32_path[],
 
     serialized_extended_pubkey_t *ext_pubkey = &ext_pubkey_check.ext_pubkey;
 
+    if (!get_cached_ext_pubkey(bip32_path, bip32_path_len, ext_pubkey)) {
+        // find parent key's fingerprint and child number
+        uint32_t parent_fingerprint = 0;
+        uint32_t child_number = 0;
+        if (bip32_path_len > 0) {
+            // here we reuse the storage for the parent keys that we will later use
+            // for the response, in order to save memory
+
+            uint8_t parent_pubkey[33];
+            crypto_get_compressed_pubkey_at_path(bip32_path,
+                                                 bip32_path_len - 1,
+                                                 parent_pubkey,
+                                                 NULL);
+
+            parent_fingerprint = crypto_get_key_fingerprint(parent_pubkey);
+            child_number = bip32_path[bip32_path_len - 1];
+        }
+
+        ext_pubkey->depth = bip32_path_len;
+        write_u32_be(ext_pubkey->parent_fingerprint, 0, parent_fingerprint);
+        write_u32_be(ext_pubkey->child_number, 0, child_number);
+
+        crypto_get_compressed_pubkey_at_path(bip32_path,
+                                             bip32_path_len,
+                                             ext_pubkey->compressed_pubkey,
+                                             ext_pubkey->chain_code);
+
+        add_cached_ext_pubkey(bip32_path, bip32_path_len, ext_pubkey);
+    }
+
     write_u32_be(ext_pubkey->version, 0, bip32_pubkey_version);
-    ext_pubkey->depth = bip32_path_len;
-    write_u32_be(ext_pubkey->parent_fingerprint, 0, parent_fingerprint);
-    write_u32_be(ext_pubkey->child_number, 0, child_number);
-
-    crypto_get_compressed_pubkey_at_path(bip32_path,
-                                         bip32_path_len,
-                                         ext_pubkey->compressed_pubkey,
-                                         ext_pubkey->chain_code);
+
     crypto_get_checksum((uint8_t *) ext_pubkey, 78, ext_pubkey_check.checksum);
 
     int serialized_pubkey_len =
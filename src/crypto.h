@@ -12,6 +12,13 @@
 #include "./common/varint.h"
 #include "./common/write.h"
 
+// Number of extended pubkeys kept in the cache used by get_serialized_extended_pubkey_at_path.
+#ifdef TARGET_NANOS
+#define N_CACHED_EXTENDED_PUBKEYS 2
+#else
+#define N_CACHED_EXTENDED_PUBKEYS 8
+#endif
+
 /**
  * A serialized extended pubkey according to BIP32 specifications.
  * All the fields are represented as fixed-length arrays serialized in big-endian.
@@ -68,6 +75,29 @@ int bip32_CKDpub(const serialized_extended_pubkey_t *parent,
                  uint32_t index,
                  serialized_extended_pubkey_t *child);
 
+/**
+ * Derives the unhardened child of a BIP32 extended private key, without deriving it again from the
+ * seed. The outputs can equal the inputs, which in that case are overwritten.
+ *
+ * @param[in]  parent_privkey
+ *   The 32-byte private key of the parent.
+ * @param[in]  parent_chain_code
+ *   The 32-byte chain code of the parent.
+ * @param[in]  index
+ *   Index of the child to derive. It MUST be not hardened, that is, strictly less than 0x80000000.
+ * @param[out] child_privkey
+ *   Pointer to a 32-byte array for the private key of the child.
+ * @param[out] child_chain_code
+ *   Pointer to a 32-byte array for the chain code of the child.
+ *
+ * @return 0 if success, a negative number on failure.
+ */
+int crypto_derive_child_private_key(const uint8_t parent_privkey[static 32],
+                                    const uint8_t parent_chain_code[static 32],
+                                    uint32_t index,
+                                    uint8_t child_privkey[static 32],
+                                    uint8_t child_chain_code[static 32]);
+
 /**
  * Convenience wrapper for cx_hash to add some data to an initialized hash context.
  *
@@ -263,6 +293,7 @@ uint32_t crypto_get_key_fingerprint(const uint8_t pub_key[static 33]);
 
 /**
  * Computes the fingerprint of the master key as per BIP32.
+ * The result is cached until crypto_pubkeys_cache_reset is called.
  *
  * @return the fingerprint of the master key.
  */
@@ -270,6 +301,8 @@ uint32_t crypto_get_master_key_fingerprint();
 
 /**
  * Computes the base58check-encoded extended pubkey at a given path.
+ * The N_CACHED_EXTENDED_PUBKEYS most recently computed extended pubkeys are cached until
+ * crypto_pubkeys_cache_reset is called.
  *
  * @param[in]  bip32_path
  *   Pointer to 32-bit array of BIP-32 derivation steps.
@@ -288,6 +321,12 @@ int get_serialized_extended_pubkey_at_path(const uint32_t bip32_path[],
                                            uint32_t bip32_pubkey_version,
                                            char out[static MAX_SERIALIZED_PUBKEY_LENGTH + 1]);
 
+/**
+ * Clears the cache of the master key fingerprint and of the extended pubkeys. Called when the app
+ * starts and when it exits, and when it switches from the legacy protocol to the new one.
+ */
+void crypto_pubkeys_cache_reset(void);
+
 /**
  * Derives the level-1 symmetric key at the given label using SLIP-0021.
  * Must be wrapped in a TRY/FINALLY block to make sure that the output key is wiped after using it.
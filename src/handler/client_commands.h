@@ -1,8 +1,20 @@
 #pragma once
 
+#include <stdbool.h>
+
+#include "../boilerplate/dispatcher.h"
+#include "../constants.h"
+
 // TODO: for all these commands, we could make some macros or helper functions to create the
 // requests and responses.
 
+// The client commands and request formats marked as "extended" below are only used if the client
+// declared that it supports them, with the P2_CLIENT_EXTENDED_COMMANDS flag in the P2 of the APDU
+// that started the command; otherwise, equivalent requests of the other client commands are used.
+static inline bool client_has_extended_commands(const dispatcher_context_t *dc) {
+    return (dc->p2 & P2_CLIENT_EXTENDED_COMMANDS) != 0;
+}
+
 // Used to send results to the host while processing a command
 // Request : context specific
 // Response: empty
@@ -15,16 +27,53 @@
 #define CCMD_GET_PREIMAGE 0x40
 
 // Request : <GET_MERKLE_LEAF_PROOF : 1> <merkle_root : 32> <tree_size: 4> <leaf_index: 4>
+//           [<max_proof_size: 1>]
 // Response: <leaf_hash: 32> <proof_size: 1> <n_proof_elements: 1> <proof_hash 1: 32> <proof_hash 2:
 // 32> ... <proof_hash n_proof_elements: 32>
 //           If n_proof_elements < proof_size, then subsequent elements will be given as responses
 //           of CCMD_GET_MORE_ELEMENTS.
+//           If max_proof_size is present (extended), only the first max_proof_size elements of
+//           the proof (starting from the leaf) are returned, as the upper part is already known.
 #define CCMD_GET_MERKLE_LEAF_PROOF 0x41
 
+// Extended
+// Request : <GET_MERKLE_LEAF_RANGE_PROOF : 1> <merkle_root : 32> <tree_size : var> <begin : var>
+//           <n_leaves : 1> <max_proof_size : 1>
+// Response: <proof_size : 1> <n_elements : 1> <element 1 : 32> ... <element n_elements : 32>
+//           The elements are the hashes of the leaves from begin to begin + n_leaves - 1, followed
+//           by the first proof_size = min(max_proof_size, full size) hashes of the Merkle proof of
+//           the subtree containing exactly those leaves. If n_elements < n_leaves + proof_size,
+//           then subsequent elements will be given as responses of CCMD_GET_MORE_ELEMENTS.
+#define CCMD_GET_MERKLE_LEAF_RANGE_PROOF 0x43
+
 // Request : <CCMD_GET_MERKLE_LEAF_INDEX : 1> <merkle_root : 32> <leaf_hash : 32>
 // Response: <is_found(0 or 1) : 1> <leaf_index : 4>
 #define CCMD_GET_MERKLE_LEAF_INDEX 0x42
 
+// Extended
+// Request : <GET_MERKLEIZED_MAP_VALUES : 1> <keys_root : 32> <values_root : 32> <map_size : var>
+//           <n_keys : 1> <key_hash 1 : 32> ... <key_hash n_keys : 32>
+// Response: for each key, <is_found(0 or 1) : 1>, followed by <index : var> <value_len : var> if
+//           is_found is 1; then <n_elements : 1> <element 1 : 32> ... <element n_elements : 32>.
+//           For each key that is found, the elements are the Merkle proof of the key in the tree
+//           of keys, the value split in chunks of 32 bytes (the last one padded with zeros), and
+//           the Merkle proof of the value in the tree of values. If n_elements is smaller than the
+//           total number of elements, subsequent elements will be given as responses of
+//           CCMD_GET_MORE_ELEMENTS.
+#define CCMD_GET_MERKLEIZED_MAP_VALUES 0x44
+
+// Extended
+// Request : <GET_MERKLE_LEAF_ELEMENT : 1> <merkle_root : 32> <tree_size : var> <leaf_index : var>
+//           <max_proof_size : 1>
+// Response: <len = preimage length : var> <proof_size : 1> <n_bytes : 1> <preimage : n_bytes>
+//           <n_proof_elements : 1> <proof_hash 1 : 32> ... <proof_hash n_proof_elements : 32>
+//           The preimage is the leaf element prefixed with a 0x00 byte; the proof is the first
+//           proof_size = min(max_proof_size, full size) hashes of the Merkle proof of the leaf.
+//           If n_bytes < len, then n_proof_elements must be 0. The remaining bytes of the
+//           preimage (as 1-byte elements), then the remaining hashes of the proof, will be given as
+//           responses of CCMD_GET_MORE_ELEMENTS.
+#define CCMD_GET_MERKLE_LEAF_ELEMENT 0x45
+
 /* GENERIC/MULTIPURPOSE */
 
 // Used to get additional elements from the host when the required response from an interruption did
@@ -31,11 +31,8 @@ void handler_get_master_fingerprint(dispatcher_context_t *dc) {
         return;
     }
 
-    uint8_t master_pubkey[33];
-    crypto_get_compressed_pubkey_at_path((uint32_t[]){}, 0, master_pubkey, NULL);
-
     uint8_t master_fingerprint_be[4];
-    write_u32_be(master_fingerprint_be, 0, crypto_get_key_fingerprint(master_pubkey));
+    write_u32_be(master_fingerprint_be, 0, crypto_get_master_key_fingerprint());
 
     SEND_RESPONSE(dc, master_fingerprint_be, sizeof(master_fingerprint_be), SW_OK);
 }
@@ -1,7 +1,8 @@
 #include <string.h>
 
 #include "check_merkle_tree_sorted.h"
-#include "get_merkle_leaf_element.h"
+#include "get_merkle_leaf_hash.h"
+#include "get_merkle_preimage.h"
 
 static int compare_byte_arrays(const uint8_t array1[],
                                size_t array1_len,
@@ -17,14 +18,30 @@ int call_check_merkle_tree_sorted_with_callback(dispatcher_context_t *dispatcher
     int prev_el_len = 0;
     uint8_t prev_el[MAX_CHECK_MERKLE_TREE_SORTED_PREIMAGE_SIZE];
 
+    // the leaf hashes are requested in ranges, in order to reduce the number of interruptions
+    uint8_t leaf_hashes[MAX_MERKLE_LEAF_RANGE_SIZE][32];
+
     for (size_t cur_el_idx = 0; cur_el_idx < size; cur_el_idx++) {
+        size_t range_pos = cur_el_idx % MAX_MERKLE_LEAF_RANGE_SIZE;
+        if (range_pos == 0) {
+            size_t range_size = size - cur_el_idx < MAX_MERKLE_LEAF_RANGE_SIZE
+                                    ? size - cur_el_idx
+                                    : MAX_MERKLE_LEAF_RANGE_SIZE;
+            if (call_get_merkle_leaf_range(dispatcher_context,
+                                           root,
+                                           size,
+                                           cur_el_idx,
+                                           range_size,
+                                           leaf_hashes) < 0) {
+                return -1;
+            }
+        }
+
         uint8_t cur_el[MAX_CHECK_MERKLE_TREE_SORTED_PREIMAGE_SIZE];
-        int cur_el_len = call_get_merkle_leaf_element(dispatcher_context,
-                                                      root,
-                                                      size,
-                                                      cur_el_idx,
-                                                      cur_el,
-                                                      sizeof(cur_el));
+        int cur_el_len = call_get_merkle_preimage(dispatcher_context,
+                                                  leaf_hashes[range_pos],
+                                                  cur_el,
+                                                  sizeof(cur_el));
 
         if (cur_el_len < 0) {
             return -1;
@@ -1,10 +1,10 @@
-#pragma once
-
 #include "get_merkle_leaf_element.h"
 
 #include "get_merkle_leaf_hash.h"
 #include "get_merkle_preimage.h"
 
+#include "../client_commands.h"
+
 int call_get_merkle_leaf_element(dispatcher_context_t *dispatcher_context,
                                  const uint8_t merkle_root[static 32],
                                  uint32_t tree_size,
@@ -13,6 +13,15 @@ int call_get_merkle_leaf_element(dispatcher_context_t *dispatcher_context,
                                  size_t out_ptr_len) {
     // LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
 
+    if (client_has_extended_commands(dispatcher_context)) {
+        return call_get_merkle_leaf_element_with_proof(dispatcher_context,
+                                                       merkle_root,
+                                                       tree_size,
+                                                       leaf_index,
+                                                       out_ptr,
+                                                       out_ptr_len);
+    }
+
     uint8_t leaf_hash[32];
 
     int res = call_get_merkle_leaf_hash(dispatcher_context,
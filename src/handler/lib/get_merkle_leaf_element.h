@@ -3,7 +3,13 @@
 #include "../../boilerplate/dispatcher.h"
 
 /**
- * TODO: docs
+ * Requests to the client the element of the leaf with the given index in the Merkle tree with the
+ * given root and size, and writes it in out_ptr. If the client supports the extended client
+ * commands, the element and its Merkle proof are requested with a single
+ * CCMD_GET_MERKLE_LEAF_ELEMENT client command; otherwise, the leaf hash is requested with
+ * CCMD_GET_MERKLE_LEAF_PROOF, then its preimage with CCMD_GET_PREIMAGE.
+ *
+ * @return the length of the element on success, a negative number on failure.
  */
 int call_get_merkle_leaf_element(dispatcher_context_t *dispatcher_context,
                                  const uint8_t merkle_root[static 32],
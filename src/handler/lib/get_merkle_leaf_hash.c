@@ -1,14 +1,204 @@
 #include <string.h>
 
 #include "get_merkle_leaf_hash.h"
+#include "get_merkle_preimage.h"
 
 #include "../../common/buffer.h"
 #include "../../common/write.h"
 #include "../../common/merkle.h"
 #include "../../common/varint.h"
 #include "../../boilerplate/sw.h"
+#include "../../crypto.h"
 #include "../client_commands.h"
 
+/**
+ * Nodes of a Merkle tree that were already authenticated with a Merkle proof.
+ * For the last leaf that was verified in a tree, we store the hashes of the nodes on the path from
+ * the root to the leaf (excluding the root), and their siblings, up to depth MERKLE_CACHE_N_LEVELS.
+ * As any other leaf of the same tree has an ancestor among those nodes, only the part of its proof
+ * below that ancestor needs to be requested to the client.
+ */
+typedef struct {
+    uint8_t root[32];
+    uint32_t tree_size;   // 0 if the slot is unused
+    uint32_t directions;  // bit d is the direction at depth d of the path (0 = left, 1 = right)
+    uint8_t n_levels;     // number of valid levels in path and siblings
+    uint32_t last_used;
+    uint8_t path[MERKLE_CACHE_N_LEVELS][32];      // node at depth d + 1 on the path to the leaf
+    uint8_t siblings[MERKLE_CACHE_N_LEVELS][32];  // sibling of the node at depth d + 1
+} merkle_cache_slot_t;
+
+typedef struct {
+    merkle_cache_slot_t slots[MERKLE_CACHE_N_SLOTS];
+    uint32_t use_counter;
+} merkle_cache_t;
+
+#ifdef TARGET_NANOS
+// on NanoS only, we optimize the usage of the globals with a custom linker script
+static merkle_cache_t __attribute__((section(".new_globals"))) G_merkle_cache;
+#else
+static merkle_cache_t G_merkle_cache;
+#endif
+
+void merkle_cache_reset(void) {
+    explicit_bzero(&G_merkle_cache, sizeof(G_merkle_cache));
+}
+
+// Returns the cache slot for the given tree, reusing the least recently used one if the tree is not
+// in the cache yet.
+static merkle_cache_slot_t *get_cache_slot(const uint8_t merkle_root[static 32],
+                                           uint32_t tree_size) {
+    merkle_cache_slot_t *slot = &G_merkle_cache.slots[0];
+    for (int i = 0; i < MERKLE_CACHE_N_SLOTS; i++) {
+        merkle_cache_slot_t *cur = &G_merkle_cache.slots[i];
+        if (cur->tree_size == tree_size && memcmp(cur->root, merkle_root, 32) == 0) {
+            slot = cur;
+            break;
+        }
+        if (cur->last_used < slot->last_used) {
+            slot = cur;
+        }
+    }
+
+    if (slot->tree_size != tree_size || memcmp(slot->root, merkle_root, 32) != 0) {
+        memcpy(slot->root, merkle_root, 32);
+        slot->tree_size = tree_size;
+        slot->n_levels = 0;
+    }
+
+    slot->last_used = ++G_merkle_cache.use_counter;
+    return slot;
+}
+
+// Finds the deepest ancestor of the node at depth target_depth on the path with the given
+// directions that is already known (possibly, the root), and updates the cached path to go through
+// it.
+// Returns the depth of the known ancestor, and sets *known_hash to its hash.
+static int find_known_ancestor(merkle_cache_slot_t *slot,
+                               const uint8_t merkle_root[static 32],
+                               uint32_t directions,
+                               int target_depth,
+                               const uint8_t **known_hash) {
+    int known_depth = 0;
+    *known_hash = merkle_root;
+    while (known_depth < slot->n_levels && known_depth < target_depth) {
+        uint32_t bit = (uint32_t) 1 << known_depth;
+        if ((slot->directions & bit) != (directions & bit)) {
+            // the path diverges here, the sibling is an ancestor of the node
+            uint8_t tmp[32];
+            memcpy(tmp, slot->path[known_depth], 32);
+            memcpy(slot->path[known_depth], slot->siblings[known_depth], 32);
+            memcpy(slot->siblings[known_depth], tmp, 32);
+
+            *known_hash = slot->path[known_depth];
+            ++known_depth;
+            break;
+        }
+        *known_hash = slot->path[known_depth];
+        ++known_depth;
+    }
+    slot->directions = directions;
+    slot->n_levels = known_depth;  // levels below are only valid after the proof is verified
+    return known_depth;
+}
+
+const uint8_t *call_read_next_element(dispatcher_context_t *dc,
+                                     uint8_t *n_available,
+                                     int n_expected) {
+    if (*n_available == 0) {
+        buffer_write_u8(dc->get_response_buffer(), CCMD_GET_MORE_ELEMENTS);
+        dc->finalize_response(SW_INTERRUPTED_EXECUTION);
+        if (dc->process_interruption(dc) < 0) {
+            return NULL;
+        }
+
+        // Parse response to CCMD_GET_MORE_ELEMENTS
+        uint8_t elements_len;
+        if (!buffer_read_u8(&dc->read_buffer, n_available) ||
+            !buffer_read_u8(&dc->read_buffer, &elements_len) ||
+            !buffer_can_read(&dc->read_buffer, (size_t) *n_available * elements_len)) {
+            return NULL;
+        }
+
+        if (elements_len != 32 || *n_available == 0 || *n_available > n_expected) {
+            // Receiving more (or less) data then expected
+            return NULL;
+        }
+    }
+
+    // we use the memory in the buffer directly, to avoid copying the hash unnecessarily
+    const uint8_t *element = dc->read_buffer.ptr + dc->read_buffer.offset;
+    buffer_seek_cur(&dc->read_buffer, 32);
+    --*n_available;
+    return element;
+}
+
+// Reads and discards the next n_skipped elements of the client's response.
+// Returns 0 on success, a negative number on failure.
+static int skip_elements(dispatcher_context_t *dc, uint8_t *n_available, int n_skipped) {
+    for (int i = n_skipped; i > 0; i--) {
+        if (call_read_next_element(dc, n_available, i) == NULL) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Verifies that node_hash is the hash of the node at depth node_depth on the cached path, reading
+// the node_depth - known_depth hashes of its Merkle proof (bottom-up) from the client's response,
+// up to the ancestor at depth known_depth whose hash is known_hash. n_after is the number of
+// elements that the client's response contains after the proof.
+// The nodes on the path are stored in the cache slot, and are marked as valid once verified.
+// Returns 0 on success, a negative number on failure.
+static int verify_proof(dispatcher_context_t *dc,
+                        merkle_cache_slot_t *slot,
+                        int node_depth,
+                        int known_depth,
+                        const uint8_t known_hash[static 32],
+                        const uint8_t node_hash[static 32],
+                        uint8_t *n_available,
+                        int n_after) {
+    uint8_t cur_hash[32];  // temporary buffer for intermediate hashes
+    memcpy(cur_hash, node_hash, 32);
+
+    // the known ancestor itself must not be overwritten, as it is not verified yet
+    if (node_depth > known_depth && node_depth <= MERKLE_CACHE_N_LEVELS) {
+        memcpy(slot->path[node_depth - 1], cur_hash, 32);
+    }
+
+    // i is the depth of the parent of the current node
+    for (int i = node_depth - 1; i >= known_depth; i--) {
+        const uint8_t *sibling_hash =
+            call_read_next_element(dc, n_available, i - known_depth + 1 + n_after);
+        if (sibling_hash == NULL) {
+            return -1;
+        }
+
+        if (i < MERKLE_CACHE_N_LEVELS) {
+            memcpy(slot->siblings[i], sibling_hash, 32);
+        }
+
+        if ((slot->directions & ((uint32_t) 1 << i)) == 0) {
+            merkle_combine_hashes(cur_hash, sibling_hash, cur_hash);
+        } else {
+            merkle_combine_hashes(sibling_hash, cur_hash, cur_hash);
+        }
+
+        if (i > known_depth && i <= MERKLE_CACHE_N_LEVELS) {
+            memcpy(slot->path[i - 1], cur_hash, 32);
+        }
+    }
+
+    if (memcmp(known_hash, cur_hash, 32) != 0) {
+        PRINTF("Merkle root mismatch");
+        return -2;
+    }
+
+    // all the nodes on the path are now authenticated
+    slot->n_levels = node_depth < MERKLE_CACHE_N_LEVELS ? node_depth : MERKLE_CACHE_N_LEVELS;
+    return 0;
+}
+
 // Reads the inputs and sends the GET_MERKLE_LEAF_PROOF request.
 int call_get_merkle_leaf_hash(dispatcher_context_t *dc,
                               const uint8_t merkle_root[static 32],
@@ -19,107 +209,367 @@ int call_get_merkle_leaf_hash(dispatcher_context_t *dc,
 
     PRINT_STACK_POINTER();
 
-    {  // make sure memory is deallocated as soon as possible
-        uint8_t tmp[9];
-        tmp[0] = CCMD_GET_MERKLE_LEAF_PROOF;
-        dc->add_to_response(tmp, 1);
+    uint32_t directions;
+    int leaf_depth = merkle_get_leaf_path(tree_size, leaf_index, &directions);
+    if (leaf_depth < 0) {
+        return -1;
+    }
 
-        dc->add_to_response(merkle_root, 32);
+    merkle_cache_slot_t *slot = get_cache_slot(merkle_root, tree_size);
 
-        int tree_size_len = varint_write(tmp, 0, tree_size);
-        dc->add_to_response(tmp, tree_size_len);
+    const uint8_t *known_hash;
+    int known_depth = find_known_ancestor(slot, merkle_root, directions, leaf_depth, &known_hash);
 
-        int leaf_index_len = varint_write(tmp, 0, leaf_index);
-        dc->add_to_response(tmp, leaf_index_len);
+    if (known_depth == leaf_depth) {
+        // the leaf hash itself is already authenticated
+        memcpy(out, known_hash, 32);
+        return 0;
+    }
 
-        dc->finalize_response(SW_INTERRUPTED_EXECUTION);
+    buffer_t *request = dc->get_response_buffer();
+    buffer_write_u8(request, CCMD_GET_MERKLE_LEAF_PROOF);
+    buffer_write_bytes(request, merkle_root, 32);
+    buffer_write_varint(request, tree_size);
+    buffer_write_varint(request, leaf_index);
+    if (known_depth > 0 && client_has_extended_commands(dc)) {
+        // only ask for the part of the proof below the known ancestor
+        buffer_write_u8(request, (uint8_t) (leaf_depth - known_depth));
     }
+    dc->finalize_response(SW_INTERRUPTED_EXECUTION);
 
     if (dc->process_interruption(dc) < 0) {
-        return -1;
+        return -2;
     }
 
-    {
-        int cur_step;          // counter for the proof steps
-        uint8_t cur_hash[32];  // temporary buffer for intermediate hashes
-        uint8_t proof_size;
-        uint8_t n_proof_elements;
-        if (!buffer_read_bytes(&dc->read_buffer, cur_hash, 32) ||
-            !buffer_read_u8(&dc->read_buffer, &proof_size) ||
-            !buffer_read_u8(&dc->read_buffer, &n_proof_elements)) {
-            return -2;
-        }
+    uint8_t proof_size;
+    uint8_t n_proof_elements;
+    if (!buffer_read_bytes(&dc->read_buffer, out, 32) ||
+        !buffer_read_u8(&dc->read_buffer, &proof_size) ||
+        !buffer_read_u8(&dc->read_buffer, &n_proof_elements)) {
+        return -3;
+    }
 
-        if (n_proof_elements > proof_size) {
-            PRINTF("Received more proof data than expected.\n");
+    // If the client sent the full proof (it always does, unless it supports the max_proof_size
+    // argument), the proof is only verified up to the known ancestor, and the hashes above it are
+    // skipped.
+    if (proof_size != leaf_depth && proof_size != leaf_depth - known_depth) {
+        PRINTF("Unexpected length of the Merkle proof.\n");
+        return -4;
+    }
+    int n_skipped = proof_size - (leaf_depth - known_depth);
 
-            // Wrong length of the Merkle proof.
-            return -3;
-        }
+    if (n_proof_elements > proof_size) {
+        PRINTF("Received more proof data than expected.\n");
 
-        if (!buffer_can_read(&dc->read_buffer, 32 * (size_t) n_proof_elements)) {
-            return -4;
-        }
+        // Wrong length of the Merkle proof.
+        return -5;
+    }
 
-        // Copy leaf hash to output (although it is not verified yet)
-        memcpy(out, cur_hash, 32);
+    if (!buffer_can_read(&dc->read_buffer, 32 * (size_t) n_proof_elements)) {
+        return -6;
+    }
 
-        // Initialize proof verification
-        cur_step = 0;
+    // the leaf hash is copied to the output although it is not verified yet
+    if (verify_proof(dc,
+                     slot,
+                     leaf_depth,
+                     known_depth,
+                     known_hash,
+                     out,
+                     &n_proof_elements,
+                     n_skipped) < 0) {
+        return -7;
+    }
 
-        while (true) {
-            int end_step = cur_step + n_proof_elements;
-            for (; cur_step < end_step; cur_step++) {
-                // we use the memory in the buffer directly, to avoid copying the hash unnecessarily
-                const uint8_t *sibling_hash = dc->read_buffer.ptr + dc->read_buffer.offset;
+    if (skip_elements(dc, &n_proof_elements, n_skipped) < 0) {
+        return -8;
+    }
 
-                int i = proof_size - cur_step - 1;
-                int direction = merkle_get_ith_direction(tree_size, leaf_index, i);
+    return 0;
+}
 
-                if (direction == 0) {
-                    merkle_combine_hashes(cur_hash, sibling_hash, cur_hash);
-                } else if (direction == 1) {
-                    merkle_combine_hashes(sibling_hash, cur_hash, cur_hash);
-                } else {
-                    return -5;  // unexpected, proof too long?
-                }
+int call_get_merkle_leaf_range(dispatcher_context_t *dc,
+                               const uint8_t merkle_root[static 32],
+                               uint32_t tree_size,
+                               uint32_t begin,
+                               uint32_t n_leaves,
+                               uint8_t out[][32]) {
+    // LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-                buffer_seek_cur(&dc->read_buffer, 32);  // consume the bytes of the sibling hash
-            }
+    PRINT_STACK_POINTER();
 
-            if (cur_step == proof_size) {
-                break;
-            }
+    if (n_leaves == 0 || n_leaves > MAX_MERKLE_LEAF_RANGE_SIZE) {
+        return -1;
+    }
 
-            uint8_t req_more[] = {CCMD_GET_MORE_ELEMENTS};
-            SET_RESPONSE(dc, req_more, sizeof(req_more), SW_INTERRUPTED_EXECUTION);
-            if (dc->process_interruption(dc) < 0) {
-                return -6;
-            }
+    // The range must be the set of leaves of a subtree: either n_leaves is a power of 2 and begin
+    // is a multiple of n_leaves, or the range is the rightmost subtree of its size.
+    uint8_t subtree_height = ceil_lg(n_leaves);
+    uint32_t aligned_size = (uint32_t) 1 << subtree_height;
+    if (begin % aligned_size != 0 || begin > tree_size || tree_size - begin < n_leaves ||
+        (n_leaves != aligned_size && tree_size - begin != n_leaves)) {
+        return -2;
+    }
 
-            // Parse response to CCMD_GET_MORE_ELEMENTS
-            uint8_t elements_len;
-            if (!buffer_read_u8(&dc->read_buffer, &n_proof_elements) ||
-                !buffer_read_u8(&dc->read_buffer, &elements_len) ||
-                !buffer_can_read(&dc->read_buffer, (size_t) n_proof_elements * elements_len)) {
-                return -7;
+    if (!client_has_extended_commands(dc)) {
+        // the client does not support GET_MERKLE_LEAF_RANGE_PROOF; request each leaf separately
+        for (uint32_t i = 0; i < n_leaves; i++) {
+            if (call_get_merkle_leaf_hash(dc, merkle_root, tree_size, begin + i, out[i]) < 0) {
+                return -3;
             }
+        }
+        return 0;
+    }
 
-            if (elements_len != 32) {
-                return -8;
-            }
+    // the leftmost leaf of a subtree with n_leaves leaves has depth subtree_height in it
+    uint32_t directions;
+    int subtree_depth = merkle_get_leaf_path(tree_size, begin, &directions) - subtree_height;
+    if (subtree_depth < 0) {
+        return -4;
+    }
 
-            if (cur_step + n_proof_elements > proof_size) {
-                // Receiving more data then expected
-                return -9;
-            }
+    merkle_cache_slot_t *slot = get_cache_slot(merkle_root, tree_size);
+
+    const uint8_t *known_hash;
+    int known_depth =
+        find_known_ancestor(slot, merkle_root, directions, subtree_depth, &known_hash);
+
+    buffer_t *request = dc->get_response_buffer();
+    buffer_write_u8(request, CCMD_GET_MERKLE_LEAF_RANGE_PROOF);
+    buffer_write_bytes(request, merkle_root, 32);
+    buffer_write_varint(request, tree_size);
+    buffer_write_varint(request, begin);
+    buffer_write_u8(request, (uint8_t) n_leaves);
+    buffer_write_u8(request, (uint8_t) (subtree_depth - known_depth));  // max proof size
+    dc->finalize_response(SW_INTERRUPTED_EXECUTION);
+
+    if (dc->process_interruption(dc) < 0) {
+        return -5;
+    }
+
+    uint8_t proof_size;
+    uint8_t n_elements;
+    if (!buffer_read_u8(&dc->read_buffer, &proof_size) ||
+        !buffer_read_u8(&dc->read_buffer, &n_elements) ||
+        !buffer_can_read(&dc->read_buffer, 32 * (size_t) n_elements)) {
+        return -6;
+    }
+
+    if (proof_size != subtree_depth - known_depth || n_elements > n_leaves + proof_size) {
+        PRINTF("Unexpected length of the Merkle proof.\n");
+        return -7;
+    }
+
+    // Read the leaf hashes, and compute the root of the subtree. Like in the binary representation
+    // of a counter, the stack contains the roots of complete subtrees of decreasing sizes.
+    uint8_t stack[MAX_MERKLE_LEAF_RANGE_HEIGHT + 1][32];
+    int stack_size = 0;
+    for (uint32_t i = 0; i < n_leaves; i++) {
+        const uint8_t *leaf_hash =
+            call_read_next_element(dc, &n_elements, n_leaves - i + proof_size);
+        if (leaf_hash == NULL) {
+            return -8;
         }
+        memcpy(out[i], leaf_hash, 32);
+        memcpy(stack[stack_size++], leaf_hash, 32);
 
-        if (memcmp(merkle_root, cur_hash, 32) != 0) {
-            PRINTF("Merkle root mismatch");
-            return -10;
+        for (uint32_t count = i + 1; count % 2 == 0; count /= 2) {
+            merkle_combine_hashes(stack[stack_size - 2],
+                                  stack[stack_size - 1],
+                                  stack[stack_size - 2]);
+            --stack_size;
         }
     }
+    // the left subtree is always the largest complete subtree
+    while (stack_size > 1) {
+        merkle_combine_hashes(stack[stack_size - 2], stack[stack_size - 1], stack[stack_size - 2]);
+        --stack_size;
+    }
+
+    if (verify_proof(dc, slot, subtree_depth, known_depth, known_hash, stack[0], &n_elements, 0) <
+        0) {
+        return -9;
+    }
+
+    return 0;
+}
+
+int call_verify_merkle_leaf_proof(dispatcher_context_t *dc,
+                                  const uint8_t merkle_root[static 32],
+                                  uint32_t tree_size,
+                                  uint32_t leaf_index,
+                                  const uint8_t leaf_hash[static 32],
+                                  uint8_t *n_available,
+                                  int n_after) {
+    uint32_t directions;
+    int leaf_depth = merkle_get_leaf_path(tree_size, leaf_index, &directions);
+    if (leaf_depth < 0) {
+        return -1;
+    }
+
+    // the full proof is verified against the root; the path replaces the one in the cache
+    merkle_cache_slot_t *slot = get_cache_slot(merkle_root, tree_size);
+    slot->directions = directions;
+    slot->n_levels = 0;
+
+    if (verify_proof(dc, slot, leaf_depth, 0, merkle_root, leaf_hash, n_available, n_after) < 0) {
+        return -2;
+    }
+    return 0;
+}
+
+// Reads the remaining bytes of a preimage, given as 1-byte elements in responses to
+// CCMD_GET_MORE_ELEMENTS, adding them to the hash and writing them to out.
+// Returns 0 on success, a negative number on failure.
+static int read_more_preimage_bytes(dispatcher_context_t *dc,
+                                    cx_sha256_t *hash_context,
+                                    buffer_t *out,
+                                    size_t bytes_remaining) {
+    while (bytes_remaining > 0) {
+        buffer_write_u8(dc->get_response_buffer(), CCMD_GET_MORE_ELEMENTS);
+        dc->finalize_response(SW_INTERRUPTED_EXECUTION);
+        if (dc->process_interruption(dc) < 0) {
+            return -1;
+        }
+
+        // Parse response to CCMD_GET_MORE_ELEMENTS
+        uint8_t n_bytes, elements_len;
+        if (!buffer_read_u8(&dc->read_buffer, &n_bytes) ||
+            !buffer_read_u8(&dc->read_buffer, &elements_len) ||
+            !buffer_can_read(&dc->read_buffer, (size_t) n_bytes * elements_len)) {
+            return -2;
+        }
+
+        if (elements_len != 1 || n_bytes == 0 || n_bytes > bytes_remaining) {
+            PRINTF("Unexpected preimage bytes.\n");
+            return -3;
+        }
+
+        const uint8_t *data = dc->read_buffer.ptr + dc->read_buffer.offset;
+        crypto_hash_update(&hash_context->header, data, n_bytes);
+        buffer_write_bytes(out, data, n_bytes);
+        buffer_seek_cur(&dc->read_buffer, n_bytes);
 
+        bytes_remaining -= n_bytes;
+    }
     return 0;
 }
+
+int call_get_merkle_leaf_element_with_proof(dispatcher_context_t *dc,
+                                            const uint8_t merkle_root[static 32],
+                                            uint32_t tree_size,
+                                            uint32_t leaf_index,
+                                            uint8_t *out_ptr,
+                                            size_t out_ptr_len) {
+    // LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    PRINT_STACK_POINTER();
+
+    uint32_t directions;
+    int leaf_depth = merkle_get_leaf_path(tree_size, leaf_index, &directions);
+    if (leaf_depth < 0) {
+        return -1;
+    }
+
+    merkle_cache_slot_t *slot = get_cache_slot(merkle_root, tree_size);
+
+    const uint8_t *known_hash;
+    int known_depth = find_known_ancestor(slot, merkle_root, directions, leaf_depth, &known_hash);
+
+    if (known_depth == leaf_depth) {
+        // the leaf hash is already authenticated, only the preimage is needed
+        uint8_t leaf_hash[32];
+        memcpy(leaf_hash, known_hash, 32);
+        return call_get_merkle_preimage(dc, leaf_hash, out_ptr, out_ptr_len);
+    }
+
+    buffer_t *request = dc->get_response_buffer();
+    buffer_write_u8(request, CCMD_GET_MERKLE_LEAF_ELEMENT);
+    buffer_write_bytes(request, merkle_root, 32);
+    buffer_write_varint(request, tree_size);
+    buffer_write_varint(request, leaf_index);
+    buffer_write_u8(request, (uint8_t) (leaf_depth - known_depth));  // max proof size
+    dc->finalize_response(SW_INTERRUPTED_EXECUTION);
+
+    if (dc->process_interruption(dc) < 0) {
+        return -2;
+    }
+
+    uint64_t preimage_len;
+    uint8_t proof_size;
+    uint8_t n_preimage_bytes;
+    if (!buffer_read_varint(&dc->read_buffer, &preimage_len) ||
+        !buffer_read_u8(&dc->read_buffer, &proof_size) ||
+        !buffer_read_u8(&dc->read_buffer, &n_preimage_bytes) ||
+        !buffer_can_read(&dc->read_buffer, n_preimage_bytes)) {
+        return -3;
+    }
+
+    // the preimage is the element prefixed with a 0x00 byte, which is not written to the output
+    if (preimage_len == 0 || n_preimage_bytes == 0 || n_preimage_bytes > preimage_len ||
+        dc->read_buffer.ptr[dc->read_buffer.offset] != 0x00) {
+        return -4;
+    }
+
+    if (preimage_len - 1 > out_ptr_len) {
+        PRINTF("Output buffer too short\n");
+        return -5;
+    }
+
+    if (proof_size == leaf_depth) {
+        // the client sent the full proof anyway; verify it against the root
+        known_depth = 0;
+        known_hash = merkle_root;
+        slot->n_levels = 0;
+    } else if (proof_size != leaf_depth - known_depth) {
+        PRINTF("Unexpected length of the Merkle proof.\n");
+        return -6;
+    }
+
+    cx_sha256_t hash_context;
+    cx_sha256_init(&hash_context);
+
+    buffer_t out_buffer = buffer_create(out_ptr, out_ptr_len);
+
+    const uint8_t *data = dc->read_buffer.ptr + dc->read_buffer.offset;
+    crypto_hash_update(&hash_context.header, data, n_preimage_bytes);
+    buffer_write_bytes(&out_buffer, data + 1, n_preimage_bytes - 1);
+    buffer_seek_cur(&dc->read_buffer, n_preimage_bytes);
+
+    // the proof elements in the response, if any, follow the preimage
+    uint8_t n_proof_elements;
+    if (!buffer_read_u8(&dc->read_buffer, &n_proof_elements) ||
+        !buffer_can_read(&dc->read_buffer, 32 * (size_t) n_proof_elements)) {
+        return -7;
+    }
+
+    if (n_proof_elements > proof_size ||
+        (n_proof_elements > 0 && n_preimage_bytes < preimage_len)) {
+        PRINTF("Unexpected number of proof elements.\n");
+        return -8;
+    }
+
+    if (read_more_preimage_bytes(dc,
+                                 &hash_context,
+                                 &out_buffer,
+                                 (size_t) preimage_len - n_preimage_bytes) < 0) {
+        return -9;
+    }
+
+    // hack: we pass the address of the final accumulator inside cx_sha256_t, so we don't need
+    // an additional variable in the stack to store the leaf hash.
+    crypto_hash_digest(&hash_context.header, (uint8_t *) &hash_context.acc, 32);
+
+    if (verify_proof(dc,
+                     slot,
+                     leaf_depth,
+                     known_depth,
+                     known_hash,
+                     (uint8_t *) &hash_context.acc,
+                     &n_proof_elements,
+                     0) < 0) {
+        return -10;
+    }
+
+    return (int) (preimage_len - 1);
+}
@@ -2,11 +2,106 @@
 
 #include "../../boilerplate/dispatcher.h"
 
+// Size of the cache of authenticated Merkle tree nodes: number of trees, and number of levels below
+// the root that are cached for each tree.
+#ifdef TARGET_NANOS
+#define MERKLE_CACHE_N_SLOTS  1
+#define MERKLE_CACHE_N_LEVELS 3
+#else
+#define MERKLE_CACHE_N_SLOTS  4
+#define MERKLE_CACHE_N_LEVELS 8
+#endif
+
+// Maximum number of leaf hashes that can be requested at once with call_get_merkle_leaf_range.
+#ifdef TARGET_NANOS
+#define MAX_MERKLE_LEAF_RANGE_HEIGHT 2
+#else
+#define MAX_MERKLE_LEAF_RANGE_HEIGHT 3
+#endif
+#define MAX_MERKLE_LEAF_RANGE_SIZE (1 << MAX_MERKLE_LEAF_RANGE_HEIGHT)
+
 /**
- * TODO: docs
+ * Requests to the client the hash of the leaf with the given index in the Merkle tree with the
+ * given root and size, and verifies its Merkle proof.
+ * Nodes that were authenticated in previous calls are cached, and the corresponding part of the
+ * proof is not verified again (nor requested, if the client supports the extended client
+ * commands); if the leaf hash itself is already known, no request is sent.
+ *
+ * @return 0 on success, a negative number on failure.
  */
 int call_get_merkle_leaf_hash(dispatcher_context_t *dispatcher_context,
                               const uint8_t merkle_root[static 32],
                               uint32_t tree_size,
                               uint32_t leaf_index,
-                              uint8_t out[static 32]);
\ No newline at end of file
+                              uint8_t out[static 32]);
+
+/**
+ * Requests to the client the hashes of the n_leaves consecutive leaves starting from index begin,
+ * in the Merkle tree with the given root and size, together with the Merkle proof of the subtree
+ * that contains exactly those leaves; the hashes are written in out, that must have room for
+ * n_leaves hashes.
+ * The range must be the set of leaves of a subtree. That is always the case if n_leaves is a power
+ * of 2 and begin is a multiple of it, and for the last (possibly shorter) range when splitting the
+ * leaves in such ranges; therefore, all the leaves can be requested in order in ranges of
+ * MAX_MERKLE_LEAF_RANGE_SIZE.
+ * If the client does not support the extended client commands, each leaf hash is requested
+ * separately, with call_get_merkle_leaf_hash.
+ *
+ * @return 0 on success, a negative number on failure.
+ */
+int call_get_merkle_leaf_range(dispatcher_context_t *dispatcher_context,
+                               const uint8_t merkle_root[static 32],
+                               uint32_t tree_size,
+                               uint32_t begin,
+                               uint32_t n_leaves,
+                               uint8_t out[][32]);
+
+/**
+ * Returns a pointer to the next 32-byte element of the client's response, requesting more elements
+ * with CCMD_GET_MORE_ELEMENTS once the ones in the current response are consumed. *n_available is
+ * the number of elements left in the current response, n_expected the number of elements that are
+ * still expected in total. The returned pointer is only valid until the next interruption.
+ *
+ * @return a pointer to the element on success, NULL on failure.
+ */
+const uint8_t *call_read_next_element(dispatcher_context_t *dispatcher_context,
+                                      uint8_t *n_available,
+                                      int n_expected);
+
+/**
+ * Verifies that leaf_hash is the hash of the leaf with the given index in the Merkle tree with the
+ * given root and size, reading its full Merkle proof (starting from the leaf) with
+ * call_read_next_element; n_after is the number of elements that the client's response contains
+ * after the proof. The authenticated nodes are added to the cache.
+ *
+ * @return 0 on success, a negative number on failure.
+ */
+int call_verify_merkle_leaf_proof(dispatcher_context_t *dispatcher_context,
+                                  const uint8_t merkle_root[static 32],
+                                  uint32_t tree_size,
+                                  uint32_t leaf_index,
+                                  const uint8_t leaf_hash[static 32],
+                                  uint8_t *n_available,
+                                  int n_after);
+
+/**
+ * Requests to the client the preimage of the leaf with the given index in the Merkle tree with the
+ * given root and size, together with the Merkle proof of the leaf, and verifies both in a single
+ * pass. The element, that is, the preimage without its 0x00 prefix, is written in out_ptr.
+ * Nodes that were authenticated in previous calls are cached, and the corresponding part of the
+ * proof is not requested again; if the leaf hash itself is already known, only the preimage is
+ * requested.
+ *
+ * @return the length of the element on success, a negative number on failure.
+ */
+int call_get_merkle_leaf_element_with_proof(dispatcher_context_t *dispatcher_context,
+                                            const uint8_t merkle_root[static 32],
+                                            uint32_t tree_size,
+                                            uint32_t leaf_index,
+                                            uint8_t *out_ptr,
+                                            size_t out_ptr_len);
+
+/**
+ * Clears the cache of authenticated Merkle tree nodes. Called at the beginning of each command.
+ */
+void merkle_cache_reset(void);
@@ -1,6 +1,7 @@
 #include <string.h>
 
 #include "../../boilerplate/sw.h"
+#include "get_merkle_leaf_index.h"
 #include "get_merkle_leaf_hash.h"
 
 #include "../client_commands.h"
@@ -11,16 +12,14 @@ int call_get_merkle_leaf_index(dispatcher_context_t *dispatcher_context,
                                const uint8_t leaf_hash[static 32]) {
     // LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
 
-    {  // free memory as soon as possible
-        uint8_t request[1 + 32 + 32];
-        request[0] = CCMD_GET_MERKLE_LEAF_INDEX;
-        memcpy(request + 1, root, 32);
-        memcpy(request + 1 + 32, leaf_hash, 32);
+    buffer_t *request = dispatcher_context->get_response_buffer();
+    buffer_write_u8(request, CCMD_GET_MERKLE_LEAF_INDEX);
+    buffer_write_bytes(request, root, 32);
+    buffer_write_bytes(request, leaf_hash, 32);
+    dispatcher_context->finalize_response(SW_INTERRUPTED_EXECUTION);
 
-        SET_RESPONSE(dispatcher_context, request, sizeof(request), SW_INTERRUPTED_EXECUTION);
-    }
     if (dispatcher_context->process_interruption(dispatcher_context) < 0) {
-        return -3;
+        return -1;
     }
 
     uint8_t found;
@@ -28,15 +27,15 @@ int call_get_merkle_leaf_index(dispatcher_context_t *dispatcher_context,
 
     if (!buffer_read_u8(&dispatcher_context->read_buffer, &found) ||
         !buffer_read_varint(&dispatcher_context->read_buffer, &index)) {
-        return -1;
+        return -2;
     }
 
     if (found != 0 && found != 1) {
-        return -2;
+        return -3;
     }
 
     if (!found) {
-        return -3;
+        return MERKLE_LEAF_NOT_FOUND;
     }
 
     // Ask the host for the leaf hash with that index
@@ -44,11 +43,11 @@ int call_get_merkle_leaf_index(dispatcher_context_t *dispatcher_context,
     int res =
         call_get_merkle_leaf_hash(dispatcher_context, root, size, index, returned_merkle_leaf_hash);
     if (res < 0) {
-        return -4;
+        return -5;
     }
 
     if (memcmp(leaf_hash, returned_merkle_leaf_hash, 32) != 0) {
-        return -5;
+        return -6;
     }
 
     return index;
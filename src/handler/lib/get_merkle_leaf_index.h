@@ -2,8 +2,15 @@
 
 #include "../../boilerplate/dispatcher.h"
 
+// Returned by call_get_merkle_leaf_index if the client declares that the leaf is not in the tree
+#define MERKLE_LEAF_NOT_FOUND (-4)
+
 /**
- * TODO: docs
+ * Requests to the client the index of the leaf with the given hash in the Merkle tree with the
+ * given root and size, and verifies the Merkle proof of the leaf at that index.
+ *
+ * @return the index of the leaf on success, MERKLE_LEAF_NOT_FOUND if the client declares that the
+ * leaf is not in the tree, another negative number on failure.
  */
 int call_get_merkle_leaf_index(dispatcher_context_t *dispatcher_context,
                                size_t size,
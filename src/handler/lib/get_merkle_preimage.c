@@ -17,13 +17,10 @@ int call_get_merkle_preimage(dispatcher_context_t *dispatcher_context,
 
     PRINT_STACK_POINTER();
 
-    uint8_t cmd = CCMD_GET_PREIMAGE;
-    dispatcher_context->add_to_response(&cmd, 1);
-
-    uint8_t zero = 0;
-    dispatcher_context->add_to_response(&zero, 1);
-
-    dispatcher_context->add_to_response(hash, 32);
+    buffer_t *request = dispatcher_context->get_response_buffer();
+    buffer_write_u8(request, CCMD_GET_PREIMAGE);
+    buffer_write_u8(request, 0);  // hash_type
+    buffer_write_bytes(request, hash, 32);
     dispatcher_context->finalize_response(SW_INTERRUPTED_EXECUTION);
 
     if (dispatcher_context->process_interruption(dispatcher_context) < 0) {
@@ -71,8 +68,8 @@ int call_get_merkle_preimage(dispatcher_context_t *dispatcher_context,
     size_t bytes_remaining = (size_t) preimage_len - partial_data_len;
 
     while (bytes_remaining > 0) {
-        uint8_t get_more_elements_req[] = {CCMD_GET_MORE_ELEMENTS};
-        SET_RESPONSE(dispatcher_context, get_more_elements_req, 1, SW_INTERRUPTED_EXECUTION);
+        buffer_write_u8(dispatcher_context->get_response_buffer(), CCMD_GET_MORE_ELEMENTS);
+        dispatcher_context->finalize_response(SW_INTERRUPTED_EXECUTION);
         if (dispatcher_context->process_interruption(dispatcher_context) < 0) {
             return -6;
         }
@@ -95,11 +92,10 @@ int call_get_merkle_preimage(dispatcher_context_t *dispatcher_context,
             return -9;
         }
 
+        data_ptr = dispatcher_context->read_buffer.ptr + dispatcher_context->read_buffer.offset;
+
         // update hash
-        crypto_hash_update(
-            &hash_context.header,
-            dispatcher_context->read_buffer.ptr + dispatcher_context->read_buffer.offset,
-            n_bytes);
+        crypto_hash_update(&hash_context.header, data_ptr, n_bytes);
 
         // write bytes to output
         buffer_write_bytes(&out_buffer, data_ptr, n_bytes);
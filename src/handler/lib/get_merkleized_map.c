@@ -1,3 +1,4 @@
+#include <stdbool.h>
 #include <string.h>
 
 #include "get_merkleized_map.h"
@@ -7,6 +8,44 @@
 
 #include "../../common/buffer.h"
 
+// Commitments of the maps whose keys were already verified to be sorted during the current command
+typedef struct {
+    uint8_t keys_roots[MAX_N_VERIFIED_MAPS][32];
+    uint64_t sizes[MAX_N_VERIFIED_MAPS];
+    size_t n_maps;
+} verified_maps_t;
+
+#ifdef TARGET_NANOS
+// on NanoS only, we optimize the usage of the globals with a custom linker script
+static verified_maps_t __attribute__((section(".new_globals"))) G_verified_maps;
+#else
+static verified_maps_t G_verified_maps;
+#endif
+
+void verified_maps_reset(void) {
+    explicit_bzero(&G_verified_maps, sizeof(G_verified_maps));
+}
+
+static bool is_map_verified(const merkleized_map_commitment_t *map) {
+    for (size_t i = 0; i < G_verified_maps.n_maps; i++) {
+        if (G_verified_maps.sizes[i] == map->size &&
+            memcmp(G_verified_maps.keys_roots[i], map->keys_root, 32) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Maps are usually accessed in the same order multiple times; therefore, once the set is full, the
+// first maps are kept, rather than the most recent ones.
+static void add_verified_map(const merkleized_map_commitment_t *map) {
+    if (G_verified_maps.n_maps < MAX_N_VERIFIED_MAPS && !is_map_verified(map)) {
+        memcpy(G_verified_maps.keys_roots[G_verified_maps.n_maps], map->keys_root, 32);
+        G_verified_maps.sizes[G_verified_maps.n_maps] = map->size;
+        ++G_verified_maps.n_maps;
+    }
+}
+
 int call_get_merkleized_map_with_callback(dispatcher_context_t *dispatcher_context,
                                           const uint8_t root[static 32],
                                           int size,
@@ -35,8 +74,19 @@ int call_get_merkleized_map_with_callback(dispatcher_context_t *dispatcher_conte
         return -1;
     }
 
-    return call_check_merkle_tree_sorted_with_callback(dispatcher_context,
-                                                       out_ptr->keys_root,
-                                                       out_ptr->size,
-                                                       keys_callback);
-}
\ No newline at end of file
+    if (keys_callback.fn == NULL && is_map_verified(out_ptr)) {
+        // the keys are already known to be sorted, and the caller does not need them
+        return 0;
+    }
+
+    int res = call_check_merkle_tree_sorted_with_callback(dispatcher_context,
+                                                          out_ptr->keys_root,
+                                                          out_ptr->size,
+                                                          keys_callback);
+    if (res < 0) {
+        return res;
+    }
+
+    add_verified_map(out_ptr);
+    return 0;
+}
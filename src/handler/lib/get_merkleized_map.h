@@ -3,8 +3,21 @@
 #include "../../boilerplate/dispatcher.h"
 #include "../../common/merkle.h"
 
+// Maximum number of maps whose keys are remembered as sorted during a command.
+#ifdef TARGET_NANOS
+#define MAX_N_VERIFIED_MAPS 4
+#else
+#define MAX_N_VERIFIED_MAPS 32
+#endif
+
 /**
- * TODO: docs
+ * Requests the commitment to the merkleized map at the given index of the Merkle tree with the
+ * given root and size, and verifies that the keys of the map are sorted. If a callback to a
+ * non-NULL function is given, it is called once for each of the keys, in lexicographical order.
+ * The first MAX_N_VERIFIED_MAPS maps whose keys are verified during a command are remembered; if no
+ * callback is given, the keys of those maps are not requested again.
+ *
+ * Returns 0 on success, or a negative number on failure.
  */
 int call_get_merkleized_map_with_callback(dispatcher_context_t *dispatcher_context,
                                           const uint8_t root[static 32],
@@ -28,3 +41,8 @@ static inline int call_get_merkleized_map(dispatcher_context_t *dispatcher_conte
                                                  make_callback(NULL, NULL),
                                                  out_ptr);
 }
+
+/**
+ * Forgets the maps whose keys were verified. Called at the beginning of each command.
+ */
+void verified_maps_reset(void);
@@ -4,6 +4,12 @@
 
 #include "get_merkle_leaf_index.h"
 #include "get_merkle_leaf_element.h"
+#include "get_merkle_leaf_hash.h"
+
+#include "../../boilerplate/sw.h"
+#include "../../common/buffer.h"
+#include "../../common/varint.h"
+#include "../client_commands.h"
 
 int call_get_merkleized_map_value(dispatcher_context_t *dispatcher_context,
                                   const merkleized_map_commitment_t *map,
@@ -30,4 +36,169 @@ int call_get_merkleized_map_value(dispatcher_context_t *dispatcher_context,
                                         index,
                                         out,
                                         out_len);
-}
\ No newline at end of file
+}
+
+// Implementation of call_get_merkleized_map_values for clients that do not support
+// GET_MERKLEIZED_MAP_VALUES: each key is looked up separately, as in call_get_merkleized_map_value.
+static int get_merkleized_map_values_one_by_one(dispatcher_context_t *dc,
+                                                const merkleized_map_commitment_t *map,
+                                                merkleized_map_lookup_t lookups[],
+                                                int n_lookups) {
+    for (int i = 0; i < n_lookups; i++) {
+        uint8_t key_merkle_hash[32];
+        merkle_compute_element_hash(lookups[i].key, lookups[i].key_len, key_merkle_hash);
+
+        int index = call_get_merkle_leaf_index(dc, map->size, map->keys_root, key_merkle_hash);
+        if (index == MERKLE_LEAF_NOT_FOUND) {
+            lookups[i].value_len = -1;
+            continue;
+        } else if (index < 0) {
+            return -1;
+        }
+
+        int value_len = call_get_merkle_leaf_element(dc,
+                                                     map->values_root,
+                                                     map->size,
+                                                     index,
+                                                     lookups[i].out,
+                                                     lookups[i].out_len);
+        if (value_len < 0) {
+            return -2;
+        }
+        lookups[i].value_len = value_len;
+    }
+    return 0;
+}
+
+int call_get_merkleized_map_values(dispatcher_context_t *dc,
+                                   const merkleized_map_commitment_t *map,
+                                   merkleized_map_lookup_t lookups[],
+                                   int n_lookups) {
+    // LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    if (n_lookups <= 0 || n_lookups > MAX_MERKLEIZED_MAP_KEYS_PER_CALL || map->size > UINT32_MAX) {
+        return -1;
+    }
+
+    if (!client_has_extended_commands(dc)) {
+        return get_merkleized_map_values_one_by_one(dc, map, lookups, n_lookups);
+    }
+
+    buffer_t *request = dc->get_response_buffer();
+    buffer_write_u8(request, CCMD_GET_MERKLEIZED_MAP_VALUES);
+    buffer_write_bytes(request, map->keys_root, 32);
+    buffer_write_bytes(request, map->values_root, 32);
+    buffer_write_varint(request, map->size);
+    buffer_write_u8(request, (uint8_t) n_lookups);
+    for (int i = 0; i < n_lookups; i++) {
+        // the key hashes are computed directly in the request
+        uint8_t *key_hash = buffer_alloc(request, 32, false);
+        if (key_hash == NULL) {
+            return -1;
+        }
+        merkle_compute_element_hash(lookups[i].key, lookups[i].key_len, key_hash);
+    }
+    dc->finalize_response(SW_INTERRUPTED_EXECUTION);
+
+    if (dc->process_interruption(dc) < 0) {
+        return -2;
+    }
+
+    uint32_t indexes[MAX_MERKLEIZED_MAP_KEYS_PER_CALL];
+    int depths[MAX_MERKLEIZED_MAP_KEYS_PER_CALL];
+
+    // total number of 32-byte elements that are expected in the response
+    int n_remaining = 0;
+
+    for (int i = 0; i < n_lookups; i++) {
+        lookups[i].value_len = -1;
+
+        uint8_t found;
+        if (!buffer_read_u8(&dc->read_buffer, &found) || (found != 0 && found != 1)) {
+            return -3;
+        }
+
+        if (!found) {
+            continue;
+        }
+
+        uint64_t index;
+        uint64_t value_len;
+        if (!buffer_read_varint(&dc->read_buffer, &index) ||
+            !buffer_read_varint(&dc->read_buffer, &value_len)) {
+            return -4;
+        }
+
+        if (index >= map->size || value_len > (uint64_t) lookups[i].out_len) {
+            PRINTF("Invalid index, or output buffer too short\n");
+            return -5;
+        }
+
+        uint32_t directions;
+        indexes[i] = (uint32_t) index;
+        depths[i] = merkle_get_leaf_path(map->size, indexes[i], &directions);
+        lookups[i].value_len = (int) value_len;
+
+        n_remaining += 2 * depths[i] + (lookups[i].value_len + 31) / 32;
+    }
+
+    uint8_t n_available;
+    if (!buffer_read_u8(&dc->read_buffer, &n_available) || n_available > n_remaining ||
+        !buffer_can_read(&dc->read_buffer, 32 * (size_t) n_available)) {
+        return -6;
+    }
+
+    for (int i = 0; i < n_lookups; i++) {
+        if (lookups[i].value_len < 0) {
+            continue;
+        }
+
+        uint8_t hash[32];
+
+        // verify that the key is in the tree of keys, at the claimed index
+        merkle_compute_element_hash(lookups[i].key, lookups[i].key_len, hash);
+        n_remaining -= depths[i];
+        if (call_verify_merkle_leaf_proof(dc,
+                                          map->keys_root,
+                                          map->size,
+                                          indexes[i],
+                                          hash,
+                                          &n_available,
+                                          n_remaining) < 0) {
+            return -7;
+        }
+
+        // read the value, then verify that it is in the tree of values, at the same index
+        for (int offset = 0; offset < lookups[i].value_len; offset += 32) {
+            const uint8_t *chunk = call_read_next_element(dc, &n_available, n_remaining);
+            if (chunk == NULL) {
+                return -8;
+            }
+            --n_remaining;
+
+            int chunk_len = lookups[i].value_len - offset < 32 ? lookups[i].value_len - offset : 32;
+            memcpy(lookups[i].out + offset, chunk, chunk_len);
+
+            // the padding of the last chunk must be zero
+            for (int j = chunk_len; j < 32; j++) {
+                if (chunk[j] != 0) {
+                    return -9;
+                }
+            }
+        }
+
+        merkle_compute_element_hash(lookups[i].out, lookups[i].value_len, hash);
+        n_remaining -= depths[i];
+        if (call_verify_merkle_leaf_proof(dc,
+                                          map->values_root,
+                                          map->size,
+                                          indexes[i],
+                                          hash,
+                                          &n_available,
+                                          n_remaining) < 0) {
+            return -10;
+        }
+    }
+
+    return 0;
+}
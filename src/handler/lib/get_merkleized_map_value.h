@@ -23,6 +23,41 @@ int call_get_merkleized_map_value(dispatcher_context_t *dispatcher_context,
                                   uint8_t *out,
                                   int out_len);
 
+// Maximum number of keys that can be requested at once with call_get_merkleized_map_values.
+#define MAX_MERKLEIZED_MAP_KEYS_PER_CALL 4
+
+/**
+ * A key to look up with call_get_merkleized_map_values, with the buffer for the corresponding
+ * value.
+ */
+typedef struct {
+    const uint8_t *key;
+    int key_len;
+    uint8_t *out;
+    int out_len;
+    int value_len;  // set by call_get_merkleized_map_values; -1 if the key is not in the map
+} merkleized_map_lookup_t;
+
+/**
+ * Batched version of call_get_merkleized_map_value: finds the values of up to
+ * MAX_MERKLEIZED_MAP_KEYS_PER_CALL keys of the same map with a single client command, and verifies
+ * the Merkle proofs of all the keys and of the values. Each value is stored in the `out` buffer of
+ * the corresponding lookup, and its length in `value_len`; `value_len` is -1 if the key is not in
+ * the map.
+ * If the client does not support the extended client commands, each key is looked up separately, as
+ * in call_get_merkleized_map_value.
+ *
+ * Returns a negative number if any of the values is too long to fit into its output buffer, or if
+ * any of the proofs failed. Returns 0 on success, even if some of the keys are not found.
+ *
+ * NOTE: this does _not_ check that the keys are lexicographically sorted; the sanity check needs to
+ * be done before.
+ */
+int call_get_merkleized_map_values(dispatcher_context_t *dispatcher_context,
+                                   const merkleized_map_commitment_t *map,
+                                   merkleized_map_lookup_t lookups[],
+                                   int n_lookups);
+
 /**
  * Convenience shortcut to read a little-endian unsigned 32-bit int.
  * TODO: more docs
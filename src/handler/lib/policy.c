@@ -47,6 +47,85 @@ typedef struct {
     uint8_t hash[32];  // when a node processed in hash mode is popped, the hash is computed here
 } policy_parser_state_t;
 
+// A key of the wallet policy, with the derivation steps that do not depend on the address index
+// already performed
+typedef struct {
+    int key_index;
+    bool has_wildcard;
+    // if has_wildcard, the /0 and /1 children of the extended pubkey; otherwise, nodes[0] is the
+    // extended pubkey itself
+    serialized_extended_pubkey_t nodes[2];
+} cached_policy_key_t;
+
+// Cache of the keys of the last wallet policy used in the current command, so that deriving the
+// pubkeys for a further address only costs one CKDpub per key
+typedef struct {
+    uint8_t keys_merkle_root[32];
+    uint32_t n_keys;
+    size_t n_entries;
+    cached_policy_key_t entries[N_CACHED_POLICY_KEYS];
+} policy_keys_cache_t;
+
+#ifdef TARGET_NANOS
+// on NanoS only, we optimize the usage of the globals with a custom linker script
+static policy_keys_cache_t __attribute__((section(".new_globals"))) G_policy_keys_cache;
+#else
+static policy_keys_cache_t G_policy_keys_cache;
+#endif
+
+void policy_keys_cache_reset(void) {
+    explicit_bzero(&G_policy_keys_cache, sizeof(G_policy_keys_cache));
+}
+
+// Returns the cached key with the given index, or NULL if not in the cache
+static const cached_policy_key_t *find_cached_key(const policy_parser_state_t *state,
+                                                  int key_index) {
+    if (G_policy_keys_cache.n_keys != state->n_keys ||
+        memcmp(G_policy_keys_cache.keys_merkle_root, state->keys_merkle_root, 32) != 0) {
+        return NULL;
+    }
+    for (size_t i = 0; i < G_policy_keys_cache.n_entries; i++) {
+        if (G_policy_keys_cache.entries[i].key_index == key_index) {
+            return &G_policy_keys_cache.entries[i];
+        }
+    }
+    return NULL;
+}
+
+// Adds a key to the cache, computing its /0 and /1 children if it has the wildcard. Keys of a
+// different wallet policy are discarded; if the cache is full, nothing is added.
+// Returns the new entry, or NULL if it was not added.
+static const cached_policy_key_t *add_cached_key(const policy_parser_state_t *state,
+                                                 int key_index,
+                                                 bool has_wildcard,
+                                                 const serialized_extended_pubkey_t *ext_pubkey) {
+    if (G_policy_keys_cache.n_keys != state->n_keys ||
+        memcmp(G_policy_keys_cache.keys_merkle_root, state->keys_merkle_root, 32) != 0) {
+        policy_keys_cache_reset();
+        memcpy(G_policy_keys_cache.keys_merkle_root, state->keys_merkle_root, 32);
+        G_policy_keys_cache.n_keys = state->n_keys;
+    }
+
+    if (G_policy_keys_cache.n_entries >= N_CACHED_POLICY_KEYS) {
+        return NULL;
+    }
+
+    cached_policy_key_t *entry = &G_policy_keys_cache.entries[G_policy_keys_cache.n_entries];
+    entry->key_index = key_index;
+    entry->has_wildcard = has_wildcard;
+    if (has_wildcard) {
+        if (bip32_CKDpub(ext_pubkey, 0, &entry->nodes[0]) < 0 ||
+            bip32_CKDpub(ext_pubkey, 1, &entry->nodes[1]) < 0) {
+            return NULL;
+        }
+    } else {
+        memcpy(&entry->nodes[0], ext_pubkey, sizeof(entry->nodes[0]));
+    }
+
+    ++G_policy_keys_cache.n_entries;
+    return entry;
+}
+
 // comparator for pointers to compressed pubkeys
 static int cmp_compressed_pubkeys(const void *a, const void *b) {
     const uint8_t *key_a = (const uint8_t *) a;
@@ -116,19 +195,40 @@ static int get_derived_pubkey(policy_parser_state_t *state, int key_index, uint8
 
     serialized_extended_pubkey_t ext_pubkey;
 
-    int ret = get_extended_pubkey(state, key_index, &ext_pubkey);
-    if (ret < 0) {
-        return -1;
+    // the node from which the pubkey is derived with the address index, if it has the wildcard
+    const serialized_extended_pubkey_t *node;
+    bool has_wildcard;
+
+    const cached_policy_key_t *cached_key = find_cached_key(state, key_index);
+    if (cached_key == NULL) {
+        int ret = get_extended_pubkey(state, key_index, &ext_pubkey);
+        if (ret < 0) {
+            return -1;
+        }
+        has_wildcard = (ret == 1);
+
+        cached_key = add_cached_key(state, key_index, has_wildcard, &ext_pubkey);
+    } else {
+        has_wildcard = cached_key->has_wildcard;
+    }
+
+    if (cached_key != NULL) {
+        node = &cached_key->nodes[has_wildcard && state->change ? 1 : 0];
+    } else {
+        // not in the cache; we derive the /0 or /1 child reusing the same memory of ext_pubkey
+        if (has_wildcard) {
+            bip32_CKDpub(&ext_pubkey, state->change, &ext_pubkey);
+        }
+        node = &ext_pubkey;
     }
 
-    if (ret == 1) {
-        // we derive the /0/i child of this pubkey
-        // we reuse the same memory of ext_pubkey
-        bip32_CKDpub(&ext_pubkey, state->change, &ext_pubkey);
-        bip32_CKDpub(&ext_pubkey, state->address_index, &ext_pubkey);
+    if (has_wildcard) {
+        // we derive the /<change>/<address_index> child of this pubkey
+        bip32_CKDpub(node, state->address_index, &ext_pubkey);
+        node = &ext_pubkey;
     }
 
-    memcpy(out, ext_pubkey.compressed_pubkey, 33);
+    memcpy(out, node->compressed_pubkey, 33);
 
     return 0;
 }
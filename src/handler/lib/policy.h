@@ -10,6 +10,15 @@
 #define WALLET_SLIP0021_LABEL_LEN \
     (sizeof(WALLET_SLIP0021_LABEL) - 1)  // sizeof counts the terminating 0
 
+/**
+ * Number of keys of the wallet policy whose decoded extended pubkeys are cached during a command.
+ */
+#ifdef TARGET_NANOS
+#define N_CACHED_POLICY_KEYS 2
+#else
+#define N_CACHED_POLICY_KEYS MAX_POLICY_MAP_KEYS
+#endif
+
 /**
  * Computes the script corresponding to a wallet policy, for a certain change and address index.
  *
@@ -62,4 +71,10 @@ int get_policy_address_type(const policy_node_t *policy);
 
  * @return true if the given hmac is valid, false otherwise.
  */
-bool check_wallet_hmac(const uint8_t wallet_id[static 32], const uint8_t wallet_hmac[static 32]);
\ No newline at end of file
+bool check_wallet_hmac(const uint8_t wallet_id[static 32], const uint8_t wallet_hmac[static 32]);
+
+/**
+ * Clears the cache of the decoded keys of the wallet policy. Called at the beginning of each
+ * command.
+ */
+void policy_keys_cache_reset(void);
@@ -81,23 +81,25 @@ typedef struct psbt_parse_rawtx_state_s {
 
 // parses the 32-bytes txid of an input in a rawtx
 static int parse_rawtxinput_txid(parse_rawtxinput_state_t *state, buffer_t *buffers[2]) {
-    uint8_t txid[32];
-    bool result = dbuffer_read_bytes(buffers, txid, 32);
-    if (result) {
-        crypto_hash_update(&state->parent_state->hash_context->header, txid, 32);
+    uint8_t tmp[32];
+    const uint8_t *txid = dbuffer_read_ptr(buffers, tmp, 32);
+    if (txid == NULL) {
+        return 0;
     }
-    return result;
+    crypto_hash_update(&state->parent_state->hash_context->header, txid, 32);
+    return 1;
 }
 
 // parses the 4-bytes vout of an input in a rawtx
 // TODO: shares logic with the previous method; try to factor out the shared code
 static int parse_rawtxinput_vout(parse_rawtxinput_state_t *state, buffer_t *buffers[2]) {
-    uint8_t vout_bytes[4];
-    bool result = dbuffer_read_bytes(buffers, vout_bytes, 4);
-    if (result) {
-        crypto_hash_update(&state->parent_state->hash_context->header, vout_bytes, 4);
+    uint8_t tmp[4];
+    const uint8_t *vout_bytes = dbuffer_read_ptr(buffers, tmp, 4);
+    if (vout_bytes == NULL) {
+        return 0;
     }
-    return result;
+    crypto_hash_update(&state->parent_state->hash_context->header, vout_bytes, 4);
+    return 1;
 }
 
 static int parse_rawtxinput_scriptsig_size(parse_rawtxinput_state_t *state, buffer_t *buffers[2]) {
@@ -122,38 +124,31 @@ static int parse_rawtxinput_scriptsig_init(parse_rawtxinput_state_t *state, buff
 }
 
 static int parse_rawtxinput_scriptsig(parse_rawtxinput_state_t *state, buffer_t *buffers[2]) {
-    uint8_t data[32];
-
-    while (true) {
-        int remaining_len = state->scriptsig_size - state->scriptsig_counter;
-
-        // We read in chunks of at most 32 bytes, so that we can always interrupt with less than 32
-        // unparsed bytes
-        int data_len = MIN(32, remaining_len);
-
-        bool read_result = dbuffer_read_bytes(buffers, data, data_len);
-        if (!read_result) {
+    // The scriptSig is only hashed, so we process it in place, in the largest available pieces
+    while (state->scriptsig_counter < state->scriptsig_size) {
+        const uint8_t *data;
+        size_t data_len = dbuffer_read_available(buffers,
+                                                 state->scriptsig_size - state->scriptsig_counter,
+                                                 &data);
+        if (data_len == 0) {
             return 0;  // could not read enough data
         }
 
         crypto_hash_update(&state->parent_state->hash_context->header, data, data_len);
 
         state->scriptsig_counter += data_len;
-
-        if (state->scriptsig_counter == state->scriptsig_size) {
-            return 1;  // done
-        }
     }
+    return 1;  // done
 }
 
 static int parse_rawtxinput_sequence(parse_rawtxinput_state_t *state, buffer_t *buffers[2]) {
-    uint8_t sequence_bytes[4];
-
-    bool result = dbuffer_read_bytes(buffers, sequence_bytes, 4);
-    if (result) {
-        crypto_hash_update(&state->parent_state->hash_context->header, sequence_bytes, 4);
+    uint8_t tmp[4];
+    const uint8_t *sequence_bytes = dbuffer_read_ptr(buffers, tmp, 4);
+    if (sequence_bytes == NULL) {
+        return 0;
     }
-    return result;
+    crypto_hash_update(&state->parent_state->hash_context->header, sequence_bytes, 4);
+    return 1;
 }
 
 static const parsing_step_t parse_rawtxinput_steps[] = {
@@ -171,21 +166,23 @@ const int n_parse_rawtxinput_steps =
 /*   PARSER FOR A RAWTX OUTPUT */
 
 static int parse_rawtxoutput_value(parse_rawtxoutput_state_t *state, buffer_t *buffers[2]) {
-    uint8_t value_bytes[8];
-    bool result = dbuffer_read_bytes(buffers, value_bytes, 8);
-    if (result) {
-        uint64_t value = read_u64_le(value_bytes, 0);
+    uint8_t tmp[8];
+    const uint8_t *value_bytes = dbuffer_read_ptr(buffers, tmp, 8);
+    if (value_bytes == NULL) {
+        return 0;
+    }
 
-        crypto_hash_update(&state->parent_state->hash_context->header, value_bytes, 8);
+    uint64_t value = read_u64_le(value_bytes, 0);
 
-        if (state->parent_state->output_index != -1) {
-            unsigned int relevant_output_index = (unsigned int) state->parent_state->output_index;
-            if (state->parent_state->out_counter == relevant_output_index) {
-                state->parent_state->parser_outputs->vout_value = value;
-            }
+    crypto_hash_update(&state->parent_state->hash_context->header, value_bytes, 8);
+
+    if (state->parent_state->output_index != -1) {
+        unsigned int relevant_output_index = (unsigned int) state->parent_state->output_index;
+        if (state->parent_state->out_counter == relevant_output_index) {
+            state->parent_state->parser_outputs->vout_value = value;
         }
     }
-    return result;
+    return 1;
 }
 
 static int parse_rawtxoutput_scriptpubkey_size(parse_rawtxoutput_state_t *state,
@@ -218,45 +215,37 @@ static int parse_rawtxoutput_scriptpubkey_init(parse_rawtxoutput_state_t *state,
 }
 
 static int parse_rawtxoutput_scriptpubkey(parse_rawtxoutput_state_t *state, buffer_t *buffers[2]) {
-    uint8_t data[32];
-
-    while (true) {
-        int remaining_len = state->scriptpubkey_size - state->scriptpubkey_counter;
+    bool is_relevant_output = state->parent_state->output_index != -1 &&
+                              state->parent_state->out_counter ==
+                                  (unsigned int) state->parent_state->output_index;
 
-        // We read in chunks of at most 32 bytes, so that we can always interrupt with less than 32
-        // unparsed bytes
-        int data_len = MIN(32, remaining_len);
+    if (is_relevant_output && state->scriptpubkey_size > MAX_PREVOUT_SCRIPTPUBKEY_LEN) {
+        return -1;  // not expecting any scriptPubkey larger than MAX_PREVOUT_SCRIPTPUBKEY_LEN
+    }
 
-        bool read_result = dbuffer_read_bytes(buffers, data, data_len);
-        if (!read_result) {
+    // The scriptPubKey is processed in place, in the largest available pieces
+    while (state->scriptpubkey_counter < state->scriptpubkey_size) {
+        const uint8_t *data;
+        size_t data_len =
+            dbuffer_read_available(buffers,
+                                   state->scriptpubkey_size - state->scriptpubkey_counter,
+                                   &data);
+        if (data_len == 0) {
             return 0;  // could not read enough data
         }
 
         crypto_hash_update(&state->parent_state->hash_context->header, data, data_len);
 
-        if (state->parent_state->output_index != -1) {
-            unsigned int relevant_output_index = (unsigned int) state->parent_state->output_index;
-            if (state->parent_state->out_counter == relevant_output_index) {
-                unsigned int scriptpubkey_len =
-                    state->parent_state->parser_outputs->vout_scriptpubkey_len;
-                if (scriptpubkey_len > MAX_PREVOUT_SCRIPTPUBKEY_LEN) {
-                    return -1;  // not expecting any scriptPubkey larger than
-                                // MAX_PREVOUT_SCRIPTPUBKEY_LEN
-                }
-
-                memcpy(state->parent_state->parser_outputs->vout_scriptpubkey +
-                           state->scriptpubkey_counter,
-                       data,
-                       data_len);
-            }
+        if (is_relevant_output) {
+            memcpy(state->parent_state->parser_outputs->vout_scriptpubkey +
+                       state->scriptpubkey_counter,
+                   data,
+                   data_len);
         }
 
         state->scriptpubkey_counter += data_len;
-
-        if (state->scriptpubkey_counter == state->scriptpubkey_size) {
-            return 1;  // done
-        }
     }
+    return 1;  // done
 }
 
 static const parsing_step_t parse_rawtxoutput_steps[] = {
@@ -272,13 +261,13 @@ const int n_parse_rawtxoutput_steps =
 /*   PARSER FOR A FULL RAWTX */
 
 static int parse_rawtx_version(parse_rawtx_state_t *state, buffer_t *buffers[2]) {
-    uint8_t version_bytes[4];
-
-    bool result = dbuffer_read_bytes(buffers, version_bytes, 4);
-    if (result) {
-        crypto_hash_update(&state->hash_context->header, version_bytes, 4);
+    uint8_t tmp[4];
+    const uint8_t *version_bytes = dbuffer_read_ptr(buffers, tmp, 4);
+    if (version_bytes == NULL) {
+        return 0;
     }
-    return result;
+    crypto_hash_update(&state->hash_context->header, version_bytes, 4);
+    return 1;
 }
 
 // Checks if this transaction is serialized according to bip144 (segwit), that is, it has a 0x00
@@ -342,11 +331,11 @@ static int parse_rawtx_inputs_init(parse_rawtx_state_t *state, buffer_t *buffers
 static int parse_rawtx_inputs(parse_rawtx_state_t *state, buffer_t *buffers[2]) {
     while (state->in_counter < state->n_inputs) {
         while (true) {
-            bool result = parser_run(parse_rawtxinput_steps,
-                                     n_parse_rawtxinput_steps,
-                                     &state->input_parser_context,
-                                     buffers,
-                                     pic);
+            int result = parser_run(parse_rawtxinput_steps,
+                                    n_parse_rawtxinput_steps,
+                                    &state->input_parser_context,
+                                    buffers,
+                                    pic);
             if (result != 1) {
                 return result;  // stream exhausted, or error
             } else {
@@ -384,11 +373,11 @@ static int parse_rawtx_outputs_init(parse_rawtx_state_t *state, buffer_t *buffer
 static int parse_rawtx_outputs(parse_rawtx_state_t *state, buffer_t *buffers[2]) {
     while (state->out_counter < state->n_outputs) {
         while (true) {
-            bool result = parser_run(parse_rawtxoutput_steps,
-                                     n_parse_rawtxoutput_steps,
-                                     &state->output_parser_context,
-                                     buffers,
-                                     pic);
+            int result = parser_run(parse_rawtxoutput_steps,
+                                    n_parse_rawtxoutput_steps,
+                                    &state->output_parser_context,
+                                    buffers,
+                                    pic);
             if (result != 1) {
                 return result;  // stream exhausted, or error
             } else {
@@ -448,13 +437,13 @@ static int parse_rawtx_witnesses(parse_rawtx_state_t *state, buffer_t *buffers[2
             }
 
             while (state->cur_wit_el_bytes_read < state->cur_wit_elem_len) {
-                uint8_t data[32];
-                int remaining_len = state->cur_wit_elem_len - state->cur_wit_el_bytes_read;
-
-                // We read in chunks of at most 32 bytes, so that we can always interrupt with less
-                // than 32 unparsed bytes
-                int data_len = MIN(32, remaining_len);
-                if (!dbuffer_read_bytes(buffers, data, data_len)) {
+                // the witness data is not used, so it is just skipped
+                const uint8_t *data;
+                size_t data_len = dbuffer_read_available(
+                    buffers,
+                    state->cur_wit_elem_len - state->cur_wit_el_bytes_read,
+                    &data);
+                if (data_len == 0) {
                     return 0;
                 }
 
@@ -473,12 +462,13 @@ static int parse_rawtx_witnesses(parse_rawtx_state_t *state, buffer_t *buffers[2
 }
 
 static int parse_rawtx_locktime(parse_rawtx_state_t *state, buffer_t *buffers[2]) {
-    uint8_t locktime_bytes[4];
-    bool result = dbuffer_read_bytes(buffers, locktime_bytes, 4);
-    if (result) {
-        crypto_hash_update(&state->hash_context->header, locktime_bytes, 4);
+    uint8_t tmp[4];
+    const uint8_t *locktime_bytes = dbuffer_read_ptr(buffers, tmp, 4);
+    if (locktime_bytes == NULL) {
+        return 0;
     }
-    return result;
+    crypto_hash_update(&state->hash_context->header, locktime_bytes, 4);
+    return 1;
 }
 
 static const parsing_step_t parse_rawtx_steps[] = {(parsing_step_t) parse_rawtx_version,
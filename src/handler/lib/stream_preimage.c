@@ -13,11 +13,10 @@ int call_stream_preimage(dispatcher_context_t *dispatcher_context,
                          void *callback_state) {
     LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
 
-    uint8_t cmd = CCMD_GET_PREIMAGE;
-    dispatcher_context->add_to_response(&cmd, 1);
-    uint8_t zero = 0;
-    dispatcher_context->add_to_response(&zero, 1);
-    dispatcher_context->add_to_response(hash, 32);
+    buffer_t *request = dispatcher_context->get_response_buffer();
+    buffer_write_u8(request, CCMD_GET_PREIMAGE);
+    buffer_write_u8(request, 0);  // hash_type
+    buffer_write_bytes(request, hash, 32);
     dispatcher_context->finalize_response(SW_INTERRUPTED_EXECUTION);
 
     if (dispatcher_context->process_interruption(dispatcher_context) < 0) {
@@ -63,11 +62,8 @@ int call_stream_preimage(dispatcher_context_t *dispatcher_context,
     size_t bytes_remaining = (size_t) preimage_len - partial_data_len;
 
     while (bytes_remaining > 0) {
-        uint8_t get_more_elements_req[] = {CCMD_GET_MORE_ELEMENTS};
-        SET_RESPONSE(dispatcher_context,
-                     get_more_elements_req,
-                     sizeof(get_more_elements_req),
-                     SW_INTERRUPTED_EXECUTION);
+        buffer_write_u8(dispatcher_context->get_response_buffer(), CCMD_GET_MORE_ELEMENTS);
+        dispatcher_context->finalize_response(SW_INTERRUPTED_EXECUTION);
         if (dispatcher_context->process_interruption(dispatcher_context) < 0) {
             return -5;
         }
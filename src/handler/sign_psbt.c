@@ -76,6 +76,7 @@ static void confirm_transaction(dispatcher_context_t *dc);
 
 // Signing process (all)
 static void sign_init(dispatcher_context_t *dc);
+static void sign_compute_segwit_hashes(dispatcher_context_t *dc);
 static void sign_process_input_map(dispatcher_context_t *dc);
 
 // Legacy sighash computation (P2PKH and P2SH)
@@ -112,11 +113,88 @@ the right paths to identify internal inputs/outputs.
 
 // HELPER FUNCTIONS
 
+// Initializes private_key with the key of the current input, deriving the change and address index
+// steps from the private key at our_key_derivation. It must be called in a TRY block that wipes
+// private_key in the FINALLY block.
+// Returns 0 on success, -1 on failure.
+static int derive_input_private_key(sign_psbt_state_t *state,
+                                    cx_ecfp_private_key_t *private_key) {
+    uint8_t privkey[32];
+    uint8_t chain_code[32];
+
+    int ret = 0;
+    if (crypto_derive_child_private_key(state->our_privkey,
+                                        state->our_chain_code,
+                                        state->cur_input.change,
+                                        privkey,
+                                        chain_code) < 0 ||
+        crypto_derive_child_private_key(privkey,
+                                        chain_code,
+                                        state->cur_input.address_index,
+                                        privkey,
+                                        chain_code) < 0) {
+        ret = -1;
+    } else {
+        cx_ecfp_init_private_key(CX_CURVE_256K1, privkey, sizeof(privkey), private_key);
+    }
+
+    explicit_bzero(privkey, sizeof(privkey));
+    explicit_bzero(chain_code, sizeof(chain_code));
+    return ret;
+}
+
+// Adds value to the running total *total. Returns false, leaving *total unchanged, on overflow;
+// that can only happen with invalid amounts, but the number of inputs and outputs is too large to
+// rule it out.
+static bool add_to_total_value(uint64_t *total, uint64_t value) {
+    if (value > UINT64_MAX - *total) {
+        PRINTF("Overflow in the total value\n");
+        return false;
+    }
+    *total += value;
+    return true;
+}
+
+// Adds an output to the outputs digest and, if there is room, to the cache of the serialized
+// outputs (except on NanoS). Called for each output, in order, during the outputs verification flow.
+static void add_output_to_digest(sign_psbt_state_t *state,
+                                 const uint8_t amount_raw[static 8],
+                                 const uint8_t *script,
+                                 size_t script_len) {
+    crypto_hash_update(&state->sha_outputs_context.header, amount_raw, 8);
+    crypto_hash_update_varint(&state->sha_outputs_context.header, script_len);
+    crypto_hash_update(&state->sha_outputs_context.header, script, script_len);
+
+#ifndef TARGET_NANOS
+    // scripts are at most MAX_PREVOUT_SCRIPTPUBKEY_LEN bytes long, so the varint is 1 byte
+    size_t length = state->cached_outputs.length;
+    if (state->cached_outputs.is_valid &&
+        length + 8 + 1 + script_len <= sizeof(state->cached_outputs.data)) {
+        uint8_t *out = state->cached_outputs.data + length;
+        memcpy(out, amount_raw, 8);
+        out[8] = (uint8_t) script_len;
+        memcpy(out + 9, script, script_len);
+        state->cached_outputs.length = length + 8 + 1 + script_len;
+    } else {
+        state->cached_outputs.is_valid = false;
+    }
+#endif
+}
+
 // Updates the hash_context with the network serialization of all the outputs
 // returns -1 on error (in that case, a response is already set). 0 on success.
+// The outputs are only requested to the client if their serialization did not fit in
+// state->cached_outputs, or always on NanoS.
 static int hash_outputs(dispatcher_context_t *dc, cx_hash_t *hash_context) {
     sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
 
+#ifndef TARGET_NANOS
+    if (state->cached_outputs.is_valid) {
+        crypto_hash_update(hash_context, state->cached_outputs.data, state->cached_outputs.length);
+        return 0;
+    }
+#endif
+
     // TODO: support other SIGHASH FLAGS
     for (unsigned int i = 0; i < state->n_outputs; i++) {
         // get this output's map
@@ -128,40 +206,107 @@ static int hash_outputs(dispatcher_context_t *dc, cx_hash_t *hash_context) {
             return -1;
         }
 
-        // get output's amount
+        // get output's amount and scriptPubKey
         uint8_t amount_raw[8];
-        if (8 != call_get_merkleized_map_value(dc,
-                                               &ith_map,
-                                               (uint8_t[]){PSBT_OUT_AMOUNT},
-                                               1,
-                                               amount_raw,
-                                               8)) {
+        uint8_t out_script[MAX_PREVOUT_SCRIPTPUBKEY_LEN];
+        merkleized_map_lookup_t lookups[] = {
+            {(uint8_t[]){PSBT_OUT_AMOUNT}, 1, amount_raw, 8, 0},
+            {(uint8_t[]){PSBT_OUT_SCRIPT}, 1, out_script, sizeof(out_script), 0},
+        };
+        if (call_get_merkleized_map_values(dc, &ith_map, lookups, 2) < 0 ||
+            lookups[0].value_len != 8 || lookups[1].value_len < 0) {
             SEND_SW(dc, SW_INCORRECT_DATA);
             return -1;
         }
+        int out_script_len = lookups[1].value_len;
 
         crypto_hash_update(hash_context, amount_raw, 8);
 
-        // get output's scriptPubKey
+        crypto_hash_update_varint(hash_context, out_script_len);
+        crypto_hash_update(hash_context, out_script, out_script_len);
+    }
 
-        uint8_t out_script[MAX_PREVOUT_SCRIPTPUBKEY_LEN];
-        int out_script_len = call_get_merkleized_map_value(dc,
-                                                           &ith_map,
-                                                           (uint8_t[]){PSBT_OUT_SCRIPT},
-                                                           1,
-                                                           out_script,
-                                                           sizeof(out_script));
-        if (out_script_len == -1) {
+    return 0;
+}
+
+// Reads the prevout hash, the prevout index and the nSequence from the map of an input, with a
+// single client command.
+// returns -1 on error. 0 on success.
+static int read_input_outpoint(dispatcher_context_t *dc,
+                               const merkleized_map_commitment_t *map,
+                               input_outpoint_t *out) {
+    merkleized_map_lookup_t lookups[] = {
+        {(uint8_t[]){PSBT_IN_PREVIOUS_TXID}, 1, out->prevout_hash, 32, 0},
+        {(uint8_t[]){PSBT_IN_OUTPUT_INDEX}, 1, out->prevout_n, 4, 0},
+        {(uint8_t[]){PSBT_IN_SEQUENCE}, 1, out->nSequence, 4, 0},
+    };
+
+    if (call_get_merkleized_map_values(dc, map, lookups, 3) < 0 || lookups[0].value_len != 32 ||
+        lookups[1].value_len != 4) {
+        return -1;
+    }
+
+    if (lookups[2].value_len != 4) {
+        // if no PSBT_IN_SEQUENCE is present, we must assume nSequence 0xFFFFFFFF
+        memset(out->nSequence, 0xFF, 4);
+    }
+
+    return 0;
+}
+
+// Reads the prevout hash, the prevout index and the nSequence of the i-th input. The first
+// N_CACHED_INPUTS inputs are cached, so they are only requested to the client the first time.
+// If map is not NULL, it must be the map of the i-th input.
+// returns -1 on error (in that case, a response is already set). 0 on success.
+static int get_input_outpoint(dispatcher_context_t *dc,
+                              unsigned int i,
+                              const merkleized_map_commitment_t *map,
+                              input_outpoint_t *out) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    if (i < state->n_cached_inputs) {
+        memcpy(out, &state->cached_inputs[i], sizeof(input_outpoint_t));
+        return 0;
+    }
+
+    // get this input's map
+    merkleized_map_commitment_t ith_map;
+    if (map == NULL) {
+        int res = call_get_merkleized_map(dc, state->inputs_root, state->n_inputs, i, &ith_map);
+        if (res < 0) {
             SEND_SW(dc, SW_INCORRECT_DATA);
             return -1;
         }
+        map = &ith_map;
+    }
 
-        crypto_hash_update_varint(hash_context, out_script_len);
-        crypto_hash_update(hash_context, out_script, out_script_len);
+    if (read_input_outpoint(dc, map, out) < 0) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return -1;
+    }
+
+    // inputs are always accessed in order, so the cache is filled sequentially
+    if (i == state->n_cached_inputs && i < N_CACHED_INPUTS) {
+        memcpy(&state->cached_inputs[i], out, sizeof(input_outpoint_t));
+        ++state->n_cached_inputs;
     }
+
     return 0;
 }
 
+static bool get_input_info(const sign_psbt_state_t *state,
+                           unsigned int input_index,
+                           unsigned int bit) {
+    return bitvector_get(state->inputs_info, input_index * INPUT_INFO_N_BITS + bit);
+}
+
+static void set_input_info(sign_psbt_state_t *state,
+                           unsigned int input_index,
+                           unsigned int bit,
+                           bool value) {
+    bitvector_set(state->inputs_info, input_index * INPUT_INFO_N_BITS + bit, value);
+}
+
 static int get_segwit_version(const uint8_t scriptPubKey[], int scriptPubKey_len) {
     if (scriptPubKey_len <= 1) {
         return -1;
@@ -189,6 +334,13 @@ void handler_sign_psbt(dispatcher_context_t *dc) {
         return;
     }
 
+    if (dc->p1 != 0 ||
+        (dc->p2 & ~(SIGN_PSBT_P2_PACK_SIGNATURES | P2_CLIENT_EXTENDED_COMMANDS)) != 0) {
+        SEND_SW(dc, SW_WRONG_P1P2);
+        return;
+    }
+    state->pack_signatures = (dc->p2 & SIGN_PSBT_P2_PACK_SIGNATURES) != 0;
+
     if (!buffer_read_varint(&dc->read_buffer, &state->global_map.size)) {
         SEND_SW(dc, SW_WRONG_DATA_LENGTH);
         return;
@@ -224,7 +376,6 @@ void handler_sign_psbt(dispatcher_context_t *dc) {
     state->n_outputs = (unsigned int) n_outputs;
 
     if (n_outputs > MAX_N_OUTPUTS_CAN_SIGN) {
-        // could remove this limitation; paranoia more than anything else
         PRINTF("At most %d outputs are supported\n", MAX_N_OUTPUTS_CAN_SIGN);
         SEND_SW(dc, SW_NOT_SUPPORTED);
         return;
@@ -318,7 +469,8 @@ void handler_sign_psbt(dispatcher_context_t *dc) {
 
     state->inputs_total_value = 0;
     state->internal_inputs_total_value = 0;
-    memset(state->internal_inputs, 0, sizeof state->internal_inputs);
+    memset(state->inputs_info, 0, sizeof state->inputs_info);
+    state->has_segwit_inputs_to_sign = false;
 
     state->master_key_fingerprint = crypto_get_master_key_fingerprint();
 
@@ -539,7 +691,10 @@ static void process_input_map(dispatcher_context_t *dc) {
 
         uint64_t prevout_value = parser_outputs.vout_value;
 
-        state->inputs_total_value += prevout_value;
+        if (!add_to_total_value(&state->inputs_total_value, prevout_value)) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
 
         state->cur_input.prevout_amount = prevout_value;
 
@@ -597,7 +752,10 @@ static void process_input_map(dispatcher_context_t *dc) {
             }
         } else {
             // we extract the scriptPubKey and prevout amount from the witness utxo
-            state->inputs_total_value += wit_utxo_prevout_amount;
+            if (!add_to_total_value(&state->inputs_total_value, wit_utxo_prevout_amount)) {
+                SEND_SW(dc, SW_INCORRECT_DATA);
+                return;
+            }
 
             state->cur_input.prevout_amount = wit_utxo_prevout_amount;
             state->cur_input.prevout_scriptpubkey_len = wit_utxo_scriptPubkey_len;
@@ -715,7 +873,7 @@ static void check_input_owned(dispatcher_context_t *dc) {
     if (external) {
         PRINTF("INPUT %d is external\n", state->cur_input_index);
     } else {
-        state->internal_inputs[state->cur_input_index] = 1;
+        set_input_info(state, state->cur_input_index, INPUT_INFO_INTERNAL, true);
         state->internal_inputs_total_value += state->cur_input.prevout_amount;
 
         int segwit_version = get_segwit_version(state->cur_input.prevout_scriptpubkey,
@@ -734,6 +892,53 @@ static void check_input_owned(dispatcher_context_t *dc) {
             SEND_SW(dc, SW_INCORRECT_DATA);
             return;
         }
+
+        // Inputs with a witness utxo are signed as segwit inputs; if there is a redeemScript, the
+        // segwit version is the one of the redeemScript, checked when signing
+        if (state->cur_input.has_witnessUtxo) {
+            state->has_segwit_inputs_to_sign = true;
+
+            if (!state->cur_input.has_redeemScript && segwit_version != 0 && segwit_version != 1) {
+                PRINTF("Segwit version not supported: %d\n", segwit_version);
+                SEND_SW(dc, SW_NOT_SUPPORTED);
+                return;
+            }
+        }
+
+        uint32_t sighash_type = SIGHASH_ALL;
+        if (state->cur_input.has_sighash_type &&
+            4 != call_get_merkleized_map_value_u32_le(dc,
+                                                      &state->cur_input.map,
+                                                      (uint8_t[]){PSBT_IN_SIGHASH_TYPE},
+                                                      1,
+                                                      &sighash_type)) {
+            PRINTF("Malformed PSBT_IN_SIGHASH_TYPE for input %d\n", state->cur_input_index);
+
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+
+        // TODO: add support for other sighash flags
+        if (sighash_type != SIGHASH_ALL) {
+            PRINTF("Only SIGHASH_ALL is currently supported\n");
+            SEND_SW(dc, SW_NOT_SUPPORTED);
+            return;
+        }
+
+        // remember what is needed to sign this input
+        set_input_info(state,
+                       state->cur_input_index,
+                       INPUT_INFO_HAS_WITNESS_UTXO,
+                       state->cur_input.has_witnessUtxo);
+        set_input_info(state,
+                       state->cur_input_index,
+                       INPUT_INFO_HAS_REDEEM_SCRIPT,
+                       state->cur_input.has_redeemScript);
+        set_input_info(state,
+                       state->cur_input_index,
+                       INPUT_INFO_SEGWIT_V1,
+                       state->cur_input.has_witnessUtxo && !state->cur_input.has_redeemScript &&
+                           segwit_version == 1);
     }
 
     ++state->cur_input_index;
@@ -748,7 +953,7 @@ static void alert_external_inputs(dispatcher_context_t *dc) {
 
     size_t count_external_inputs = 0;
     for (unsigned int i = 0; i < state->n_inputs; i++) {
-        if (!state->internal_inputs[i]) {
+        if (!get_input_info(state, i, INPUT_INFO_INTERNAL)) {
             ++count_external_inputs;
         }
     }
@@ -800,6 +1005,13 @@ static void verify_outputs_init(dispatcher_context_t *dc) {
 
     state->external_outputs_count = 0;
 
+    // the outputs digest and the cache of the serialized outputs are filled while verifying them
+    cx_sha256_init(&state->sha_outputs_context);
+#ifndef TARGET_NANOS
+    state->cached_outputs.is_valid = true;
+    state->cached_outputs.length = 0;
+#endif
+
     dc->next(process_output_map);
 }
 
@@ -847,6 +1059,8 @@ static void process_output_map(dispatcher_context_t *dc) {
 
     if (state->cur_output_index >= state->n_outputs) {
         // all outputs already processed
+        crypto_hash_digest(&state->sha_outputs_context.header, state->hashes.sha_outputs, 32);
+
         dc->next(confirm_transaction);
         return;
     }
@@ -874,42 +1088,35 @@ static void process_output_map(dispatcher_context_t *dc) {
     // read output amount and scriptpubkey
 
     uint8_t raw_result[8];
-
-    // Read the output's amount
-    int result_len = call_get_merkleized_map_value(dc,
-                                                   &state->cur_output.map,
-                                                   (uint8_t[]){PSBT_OUT_AMOUNT},
-                                                   1,
-                                                   raw_result,
-                                                   sizeof(raw_result));
-    if (result_len != 8) {
+    merkleized_map_lookup_t lookups[] = {
+        {(uint8_t[]){PSBT_OUT_AMOUNT}, 1, raw_result, sizeof(raw_result), 0},
+        {(uint8_t[]){PSBT_OUT_SCRIPT},
+         1,
+         state->cur_output.scriptpubkey,
+         sizeof(state->cur_output.scriptpubkey),
+         0},
+    };
+    if (call_get_merkleized_map_values(dc, &state->cur_output.map, lookups, 2) < 0 ||
+        lookups[0].value_len != 8 || lookups[1].value_len < 0) {
+        // also fails if the output's scriptPubKey is too long
         SEND_SW(dc, SW_INCORRECT_DATA);
         return;
     }
+
     uint64_t value = read_u64_le(raw_result, 0);
 
     state->cur_output.value = value;
-    state->outputs_total_value += value;
-
-    // Read the output's scriptPubKey
-
-    // Read the output's amount
-    result_len = call_get_merkleized_map_value(dc,
-                                               &state->cur_output.map,
-                                               (uint8_t[]){PSBT_OUT_SCRIPT},
-                                               1,
-                                               state->cur_output.scriptpubkey,
-                                               sizeof(state->cur_output.scriptpubkey));
-    if (result_len == -1) {
-        SEND_SW(dc, SW_INCORRECT_DATA);
-        return;
-    } else if (result_len > (int) sizeof(state->cur_output.scriptpubkey)) {
-        PRINTF("Output's scriptPubKey too long: %d\n", result_len);
+    if (!add_to_total_value(&state->outputs_total_value, value)) {
         SEND_SW(dc, SW_INCORRECT_DATA);
         return;
     }
 
-    state->cur_output.scriptpubkey_len = result_len;
+    state->cur_output.scriptpubkey_len = lookups[1].value_len;
+
+    add_output_to_digest(state,
+                         raw_result,
+                         state->cur_output.scriptpubkey,
+                         state->cur_output.scriptpubkey_len);
 
     dc->next(check_output_owned);
 }
@@ -1200,6 +1407,115 @@ static void sign_init(dispatcher_context_t *dc) {
         return;
     }
 
+    // The hardened derivation steps from the seed are expensive; therefore, we derive the private
+    // key at our key's derivation path only once, and each input only costs the two unhardened
+    // steps for change and address index.
+    cx_ecfp_private_key_t our_private_key = {0};
+    int res = crypto_derive_private_key(&our_private_key,
+                                        state->our_chain_code,
+                                        state->our_key_derivation,
+                                        state->our_key_derivation_length);
+    memcpy(state->our_privkey, our_private_key.d, sizeof(state->our_privkey));
+    explicit_bzero(&our_private_key, sizeof(our_private_key));
+    if (res < 0) {
+        SEND_SW(dc, SW_BAD_STATE);
+        return;
+    }
+
+    // the cache of the inputs is filled while computing the sighashes; the outputs were already
+    // serialized while verifying them
+    state->n_cached_inputs = 0;
+
+    dc->next(sign_compute_segwit_hashes);
+}
+
+// Computes the tx-wide hashes used in the BIP143 and BIP341 sighash computations. They only
+// depend on the transaction, therefore they are computed once before signing any input.
+static void sign_compute_segwit_hashes(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    if (!state->has_segwit_inputs_to_sign) {
+        // legacy inputs only, the hashes are not used
+        state->cur_input_index = 0;
+        dc->next(sign_process_input_map);
+        return;
+    }
+
+    {
+        // compute sha_prevouts and sha_sequences
+        cx_sha256_t sha_prevouts_context, sha_sequences_context;
+
+        // compute hashPrevouts and hashSequence
+        cx_sha256_init(&sha_prevouts_context);
+        cx_sha256_init(&sha_sequences_context);
+
+        for (unsigned int i = 0; i < state->n_inputs; i++) {
+            input_outpoint_t ith_outpoint;
+            if (get_input_outpoint(dc, i, NULL, &ith_outpoint) < 0) {
+                return;  // response already set
+            }
+
+            crypto_hash_update(&sha_prevouts_context.header, ith_outpoint.prevout_hash, 32);
+            crypto_hash_update(&sha_prevouts_context.header, ith_outpoint.prevout_n, 4);
+
+            crypto_hash_update(&sha_sequences_context.header, ith_outpoint.nSequence, 4);
+        }
+
+        crypto_hash_digest(&sha_prevouts_context.header, state->hashes.sha_prevouts, 32);
+        crypto_hash_digest(&sha_sequences_context.header, state->hashes.sha_sequences, 32);
+    }
+
+    // sha_outputs was already computed while verifying the outputs
+
+    {
+        // compute sha_amounts and sha_scriptpubkeys
+        cx_sha256_t sha_amounts_context, sha_scriptpubkeys_context;
+
+        cx_sha256_init(&sha_amounts_context);
+        cx_sha256_init(&sha_scriptpubkeys_context);
+
+        for (unsigned int i = 0; i < state->n_inputs; i++) {
+            // get this input's map
+            merkleized_map_commitment_t ith_map;
+
+            int res = call_get_merkleized_map(dc, state->inputs_root, state->n_inputs, i, &ith_map);
+            if (res < 0) {
+                SEND_SW(dc, SW_INCORRECT_DATA);
+                return;
+            }
+
+            // get prevout hash and output index for the i-th input
+            uint8_t wit_utxo[8 + 1 + MAX_PREVOUT_SCRIPTPUBKEY_LEN];
+            int ret = call_get_merkleized_map_value(dc,
+                                                    &ith_map,
+                                                    (uint8_t[]){PSBT_IN_WITNESS_UTXO},
+                                                    1,
+                                                    wit_utxo,
+                                                    sizeof(wit_utxo));
+            if (ret < 9) {
+                SEND_SW(dc, SW_INCORRECT_DATA);
+                return;
+            }
+            uint8_t scriptPubKey_len = wit_utxo[8];
+            if (ret != 8 + 1 + scriptPubKey_len) {
+                SEND_SW(dc, SW_INCORRECT_DATA);
+                return;
+            }
+
+            uint8_t *scriptPubKey = wit_utxo + 9;
+
+            crypto_hash_update(&sha_amounts_context.header, wit_utxo, 8);
+
+            crypto_hash_update_varint(&sha_scriptpubkeys_context.header, scriptPubKey_len);
+            crypto_hash_update(&sha_scriptpubkeys_context.header, scriptPubKey, scriptPubKey_len);
+        }
+
+        crypto_hash_digest(&sha_amounts_context.header, state->hashes.sha_amounts, 32);
+        crypto_hash_digest(&sha_scriptpubkeys_context.header, state->hashes.sha_scriptpubkeys, 32);
+    }
+
     state->cur_input_index = 0;
     dc->next(sign_process_input_map);
 }
@@ -1211,7 +1527,7 @@ static void sign_process_input_map(dispatcher_context_t *dc) {
 
     // skip external inputs
     while (state->cur_input_index < state->n_inputs &&
-           !state->internal_inputs[state->cur_input_index]) {
+           !get_input_info(state, state->cur_input_index, INPUT_INFO_INTERNAL)) {
         PRINTF("Skipping signing external input %d\n", state->cur_input_index);
         ++state->cur_input_index;
     }
@@ -1237,28 +1553,8 @@ static void sign_process_input_map(dispatcher_context_t *dc) {
         return;
     }
 
-    if (!state->cur_input.has_sighash_type) {
-        state->cur_input.sighash_type = SIGHASH_ALL;
-    } else {
-        // Get sighash type
-        if (4 != call_get_merkleized_map_value_u32_le(dc,
-                                                      &state->cur_input.map,
-                                                      (uint8_t[]){PSBT_IN_SIGHASH_TYPE},
-                                                      1,
-                                                      &state->cur_input.sighash_type)) {
-            PRINTF("Malformed PSBT_IN_SIGHASH_TYPE for input %d\n", state->cur_input_index);
-
-            SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
-        }
-    }
-
-    // TODO: add support for other sighash flags
-    if (state->cur_input.sighash_type != SIGHASH_ALL) {
-        PRINTF("Only SIGHASH_ALL is currently supported\n");
-        SEND_SW(dc, SW_NOT_SUPPORTED);
-        return;
-    }
+    // only SIGHASH_ALL is accepted while verifying the inputs
+    state->cur_input.sighash_type = SIGHASH_ALL;
 
     // get path, obtain change and address_index
 
@@ -1301,7 +1597,7 @@ static void sign_process_input_map(dispatcher_context_t *dc) {
     state->cur_input.address_index = bip32_path[bip32_path_len - 1];
 
     // Sign as segwit input iff it has a witness utxo
-    if (!state->cur_input.has_witnessUtxo) {
+    if (!get_input_info(state, state->cur_input_index, INPUT_INFO_HAS_WITNESS_UTXO)) {
         dc->next(sign_legacy);
     } else {
         dc->next(sign_segwit);
@@ -1317,34 +1613,28 @@ static void sign_legacy(dispatcher_context_t *dc) {
 
     // sign_non_witness(non_witness_utxo.vout[psbt.tx.input_[i].prevout.n].scriptPubKey, i)
 
-    // Read the prevout index
-    uint32_t prevout_n;
-    if (4 != call_get_merkleized_map_value_u32_le(dc,
-                                                  &state->cur_input.map,
-                                                  (uint8_t[]){PSBT_IN_OUTPUT_INDEX},
-                                                  1,
-                                                  &prevout_n)) {
-        SEND_SW(dc, SW_INCORRECT_DATA);
-        return;
-    }
+    // For P2SH, the script_code is the redeemScript, and the prevout's scriptPubKey is not needed.
+    // For P2PKH, the input was verified to be internal, that is, the prevout's scriptPubKey in the
+    // non-witness utxo is the wallet's script at the input's derivation path; so we derive it
+    // again, rather than parsing the whole non-witness utxo a second time.
+    if (!get_input_info(state, state->cur_input_index, INPUT_INFO_HAS_REDEEM_SCRIPT)) {
+        buffer_t script_buf = buffer_create(state->cur_input.prevout_scriptpubkey,
+                                            sizeof(state->cur_input.prevout_scriptpubkey));
 
-    txid_parser_outputs_t parser_outputs;
-    // request non-witness utxo, and get the prevout's value and scriptpubkey
-    int res = call_psbt_parse_rawtx(dc,
-                                    &state->cur_input.map,
-                                    (uint8_t[]){PSBT_IN_NON_WITNESS_UTXO},
-                                    1,
-                                    prevout_n,
-                                    &parser_outputs);
-    if (res < 0) {
-        SEND_SW(dc, SW_INCORRECT_DATA);
-        return;
-    }
+        int script_len = call_get_wallet_script(dc,
+                                                &state->wallet_policy_map,
+                                                state->wallet_header_keys_info_merkle_root,
+                                                state->wallet_header_n_keys,
+                                                state->cur_input.change,
+                                                state->cur_input.address_index,
+                                                &script_buf);
+        if (script_len < 0 || script_len > MAX_PREVOUT_SCRIPTPUBKEY_LEN) {
+            SEND_SW(dc, SW_BAD_STATE);  // should never happen
+            return;
+        }
 
-    state->cur_input.prevout_scriptpubkey_len = parser_outputs.vout_scriptpubkey_len;
-    memcpy(state->cur_input.prevout_scriptpubkey,
-           parser_outputs.vout_scriptpubkey,
-           parser_outputs.vout_scriptpubkey_len);
+        state->cur_input.prevout_scriptpubkey_len = script_len;
+    }
 
     dc->next(sign_legacy_compute_sighash);
 }
@@ -1364,53 +1654,19 @@ static void sign_legacy_compute_sighash(dispatcher_context_t *dc) {
     crypto_hash_update_varint(&sighash_context.header, state->n_inputs);
 
     for (unsigned int i = 0; i < state->n_inputs; i++) {
-        // get this input's map
-        merkleized_map_commitment_t ith_map;
-
-        if (i != state->cur_input_index) {
-            int res = call_get_merkleized_map(dc, state->inputs_root, state->n_inputs, i, &ith_map);
-            if (res < 0) {
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-        } else {
-            // Avoid requesting the same map unnecessarily
-            // (might be removed once a caching mechanism is implemented)
-            memcpy(&ith_map, &state->cur_input.map, sizeof(state->cur_input.map));
+        input_outpoint_t ith_outpoint;
+        if (get_input_outpoint(dc, i, NULL, &ith_outpoint) < 0) {
+            return;  // response already set
         }
 
-        // get prevout hash and output index for the i-th input
-        uint8_t ith_prevout_hash[32];
-        if (32 != call_get_merkleized_map_value(dc,
-                                                &ith_map,
-                                                (uint8_t[]){PSBT_IN_PREVIOUS_TXID},
-                                                1,
-                                                ith_prevout_hash,
-                                                32)) {
-            SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
-        }
-
-        crypto_hash_update(&sighash_context.header, ith_prevout_hash, 32);
-
-        uint8_t ith_prevout_n_raw[4];
-        if (4 != call_get_merkleized_map_value(dc,
-                                               &ith_map,
-                                               (uint8_t[]){PSBT_IN_OUTPUT_INDEX},
-                                               1,
-                                               ith_prevout_n_raw,
-                                               4)) {
-            SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
-        }
-
-        crypto_hash_update(&sighash_context.header, ith_prevout_n_raw, 4);
+        crypto_hash_update(&sighash_context.header, ith_outpoint.prevout_hash, 32);
+        crypto_hash_update(&sighash_context.header, ith_outpoint.prevout_n, 4);
 
         if (i != state->cur_input_index) {
             // empty scriptcode
             crypto_hash_update_u8(&sighash_context.header, 0x00);
         } else {
-            if (!state->cur_input.has_redeemScript) {
+            if (!get_input_info(state, state->cur_input_index, INPUT_INFO_HAS_REDEEM_SCRIPT)) {
                 // P2PKH, the script_code is the prevout's scriptPubKey
                 crypto_hash_update_varint(&sighash_context.header,
                                           state->cur_input.prevout_scriptpubkey_len);
@@ -1437,18 +1693,7 @@ static void sign_legacy_compute_sighash(dispatcher_context_t *dc) {
             }
         }
 
-        uint8_t ith_nSequence_raw[4];
-        if (4 != call_get_merkleized_map_value(dc,
-                                               &ith_map,
-                                               (uint8_t[]){PSBT_IN_SEQUENCE},
-                                               1,
-                                               ith_nSequence_raw,
-                                               4)) {
-            // if no PSBT_IN_SEQUENCE is present, we must assume nSequence 0xFFFFFFFF
-            memset(ith_nSequence_raw, 0xFF, 4);
-        }
-
-        crypto_hash_update(&sighash_context.header, ith_nSequence_raw, 4);
+        crypto_hash_update(&sighash_context.header, ith_outpoint.nSequence, 4);
     }
 
     // outputs
@@ -1549,7 +1794,9 @@ static void sign_segwit(dispatcher_context_t *dc) {
             state->cur_input.script_len = wit_utxo_scriptPubkey_len;
             memcpy(state->cur_input.script, wit_utxo_scriptPubkey, wit_utxo_scriptPubkey_len);
 
-            segwit_version = get_segwit_version(wit_utxo_scriptPubkey, wit_utxo_scriptPubkey_len);
+            // already checked to be 0 or 1 while verifying the inputs
+            segwit_version =
+                get_input_info(state, state->cur_input_index, INPUT_INFO_SEGWIT_V1) ? 1 : 0;
         }
     }
 
@@ -1559,132 +1806,6 @@ static void sign_segwit(dispatcher_context_t *dc) {
         return;
     }
 
-    // compute all the tx-wide hashes
-
-    {
-        // compute sha_prevouts and sha_sequences
-        cx_sha256_t sha_prevouts_context, sha_sequences_context;
-
-        // compute hashPrevouts and hashSequence
-        cx_sha256_init(&sha_prevouts_context);
-        cx_sha256_init(&sha_sequences_context);
-
-        for (unsigned int i = 0; i < state->n_inputs; i++) {
-            // get this input's map
-            merkleized_map_commitment_t ith_map;
-
-            int res = call_get_merkleized_map(dc, state->inputs_root, state->n_inputs, i, &ith_map);
-            if (res < 0) {
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-
-            // get prevout hash and output index for the i-th input
-            uint8_t ith_prevout_hash[32];
-            if (32 != call_get_merkleized_map_value(dc,
-                                                    &ith_map,
-                                                    (uint8_t[]){PSBT_IN_PREVIOUS_TXID},
-                                                    1,
-                                                    ith_prevout_hash,
-                                                    32)) {
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-
-            crypto_hash_update(&sha_prevouts_context.header, ith_prevout_hash, 32);
-
-            uint8_t ith_prevout_n_raw[4];
-            if (4 != call_get_merkleized_map_value(dc,
-                                                   &ith_map,
-                                                   (uint8_t[]){PSBT_IN_OUTPUT_INDEX},
-                                                   1,
-                                                   ith_prevout_n_raw,
-                                                   4)) {
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-
-            crypto_hash_update(&sha_prevouts_context.header, ith_prevout_n_raw, 4);
-
-            uint8_t ith_nSequence_raw[4];
-            if (4 != call_get_merkleized_map_value(dc,
-                                                   &ith_map,
-                                                   (uint8_t[]){PSBT_IN_SEQUENCE},
-                                                   1,
-                                                   ith_nSequence_raw,
-                                                   4)) {
-                // if no PSBT_IN_SEQUENCE is present, we must assume nSequence 0xFFFFFFFF
-                memset(ith_nSequence_raw, 0xFF, 4);
-            }
-
-            crypto_hash_update(&sha_sequences_context.header, ith_nSequence_raw, 4);
-        }
-
-        crypto_hash_digest(&sha_prevouts_context.header, state->hashes.sha_prevouts, 32);
-        crypto_hash_digest(&sha_sequences_context.header, state->hashes.sha_sequences, 32);
-    }
-
-    {
-        // compute sha_outputs
-        cx_sha256_t sha_outputs_context;
-        cx_sha256_init(&sha_outputs_context);
-
-        if (hash_outputs(dc, &sha_outputs_context.header) == -1) {
-            return;
-        }
-
-        crypto_hash_digest(&sha_outputs_context.header, state->hashes.sha_outputs, 32);
-    }
-
-    {
-        // compute sha_amounts and sha_scriptpubkeys
-        // TODO: could be skipped if there are no segwitv1 inputs to sign
-
-        cx_sha256_t sha_amounts_context, sha_scriptpubkeys_context;
-
-        cx_sha256_init(&sha_amounts_context);
-        cx_sha256_init(&sha_scriptpubkeys_context);
-
-        for (unsigned int i = 0; i < state->n_inputs; i++) {
-            // get this input's map
-            merkleized_map_commitment_t ith_map;
-
-            int res = call_get_merkleized_map(dc, state->inputs_root, state->n_inputs, i, &ith_map);
-            if (res < 0) {
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-
-            // get prevout hash and output index for the i-th input
-            uint8_t wit_utxo[8 + 1 + MAX_PREVOUT_SCRIPTPUBKEY_LEN];
-            int ret = call_get_merkleized_map_value(dc,
-                                                    &ith_map,
-                                                    (uint8_t[]){PSBT_IN_WITNESS_UTXO},
-                                                    1,
-                                                    wit_utxo,
-                                                    sizeof(wit_utxo));
-            if (ret < 9) {
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-            uint8_t scriptPubKey_len = wit_utxo[8];
-            if (ret != 8 + 1 + scriptPubKey_len) {
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-
-            uint8_t *scriptPubKey = wit_utxo + 9;
-
-            crypto_hash_update(&sha_amounts_context.header, wit_utxo, 8);
-
-            crypto_hash_update_varint(&sha_scriptpubkeys_context.header, scriptPubKey_len);
-            crypto_hash_update(&sha_scriptpubkeys_context.header, scriptPubKey, scriptPubKey_len);
-        }
-
-        crypto_hash_digest(&sha_amounts_context.header, state->hashes.sha_amounts, 32);
-        crypto_hash_digest(&sha_scriptpubkeys_context.header, state->hashes.sha_scriptpubkeys, 32);
-    }
-
     if (segwit_version == 0) {
         dc->next(sign_segwit_v0);
         return;
@@ -1708,6 +1829,9 @@ static void sign_segwit_v0(dispatcher_context_t *dc) {
 
     uint8_t tmp[8];
 
+    // prevout hash, prevout index and nSequence of the current input
+    input_outpoint_t outpoint;
+
     // nVersion
     write_u32_le(tmp, 0, state->tx_version);
     crypto_hash_update(&sighash_context.header, tmp, 4);
@@ -1728,31 +1852,13 @@ static void sign_segwit_v0(dispatcher_context_t *dc) {
         // outpoint (32-byte prevout hash, 4-byte index)
 
         // get prevout hash and output index for the current input
-        uint8_t prevout_hash[32];
-        if (32 != call_get_merkleized_map_value(dc,
-                                                &state->cur_input.map,
-                                                (uint8_t[]){PSBT_IN_PREVIOUS_TXID},
-                                                1,
-                                                prevout_hash,
-                                                32)) {
-            SEND_SW(dc, SW_INCORRECT_DATA);
+        if (get_input_outpoint(dc, state->cur_input_index, &state->cur_input.map, &outpoint) <
+            0) {
             return;
         }
 
-        crypto_hash_update(&sighash_context.header, prevout_hash, 32);
-
-        uint8_t prevout_n_raw[4];
-        if (4 != call_get_merkleized_map_value(dc,
-                                               &state->cur_input.map,
-                                               (uint8_t[]){PSBT_IN_OUTPUT_INDEX},
-                                               1,
-                                               prevout_n_raw,
-                                               4)) {
-            SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
-        }
-
-        crypto_hash_update(&sighash_context.header, prevout_n_raw, 4);
+        crypto_hash_update(&sighash_context.header, outpoint.prevout_hash, 32);
+        crypto_hash_update(&sighash_context.header, outpoint.prevout_n, 4);
     }
 
     // scriptCode
@@ -1821,19 +1927,7 @@ static void sign_segwit_v0(dispatcher_context_t *dc) {
     }
 
     // nSequence
-    {
-        uint8_t nSequence_raw[4];
-        if (4 != call_get_merkleized_map_value(dc,
-                                               &state->cur_input.map,
-                                               (uint8_t[]){PSBT_IN_SEQUENCE},
-                                               1,
-                                               nSequence_raw,
-                                               4)) {
-            // if no PSBT_IN_SEQUENCE is present, we must assume nSequence 0xFFFFFFFF
-            memset(nSequence_raw, 0xFF, 4);
-        }
-        crypto_hash_update(&sighash_context.header, nSequence_raw, 4);
-    }
+    crypto_hash_update(&sighash_context.header, outpoint.nSequence, 4);
 
     {
         // compute hashOutputs = sha256(sha_outputs)
@@ -1898,29 +1992,17 @@ static void sign_segwit_v1(dispatcher_context_t *dc) {
     crypto_hash_update_u8(&sighash_context.header, 0x00);
 
     if ((sighash_byte & 0x80) == SIGHASH_ANYONECANPAY) {
-        // outpoint (hash)
-        if (32 != call_get_merkleized_map_value(dc,
-                                                &state->cur_input.map,
-                                                (uint8_t[]){PSBT_IN_PREVIOUS_TXID},
-                                                1,
-                                                tmp,
-                                                32)) {
-            SEND_SW(dc, SW_INCORRECT_DATA);
+        input_outpoint_t outpoint;
+        if (get_input_outpoint(dc, state->cur_input_index, &state->cur_input.map, &outpoint) <
+            0) {
             return;
         }
-        crypto_hash_update(&sighash_context.header, tmp, 32);
+
+        // outpoint (hash)
+        crypto_hash_update(&sighash_context.header, outpoint.prevout_hash, 32);
 
         // outpoint (output index)
-        if (4 != call_get_merkleized_map_value(dc,
-                                               &state->cur_input.map,
-                                               (uint8_t[]){PSBT_IN_OUTPUT_INDEX},
-                                               1,
-                                               tmp,
-                                               4)) {
-            SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
-        }
-        crypto_hash_update(&sighash_context.header, tmp, 4);
+        crypto_hash_update(&sighash_context.header, outpoint.prevout_n, 4);
 
         // amount
         write_u64_le(tmp, 0, state->cur_input.prevout_amount);
@@ -1932,16 +2014,7 @@ static void sign_segwit_v1(dispatcher_context_t *dc) {
                            state->cur_input.prevout_scriptpubkey_len);
 
         // nSequence
-        if (4 != call_get_merkleized_map_value(dc,
-                                               &state->cur_input.map,
-                                               (uint8_t[]){PSBT_IN_SEQUENCE},
-                                               1,
-                                               tmp,
-                                               4)) {
-            // if no PSBT_IN_SEQUENCE is present, we must assume nSequence 0xFFFFFFFF
-            memset(tmp, 0xFF, 4);
-        }
-        crypto_hash_update(&sighash_context.header, tmp, 4);
+        crypto_hash_update(&sighash_context.header, outpoint.nSequence, 4);
     } else {
         // input_index
         write_u32_le(tmp, 0, state->cur_input_index);
@@ -1957,42 +2030,121 @@ static void sign_segwit_v1(dispatcher_context_t *dc) {
     dc->next(sign_sighash_schnorr);
 }
 
+#ifndef TARGET_NANOS
+// Yields all the signatures in the buffer of packed signatures with a single YIELD, and empties it
+static int yield_packed_signatures(dispatcher_context_t *dc, sign_psbt_state_t *state) {
+    buffer_t *response = dc->get_response_buffer();
+    buffer_write_u8(response, CCMD_YIELD);
+    buffer_write_bytes(response, state->packed_signatures, state->packed_signatures_len);
+    dc->finalize_response(SW_INTERRUPTED_EXECUTION);
+
+    state->packed_signatures_len = 0;
+
+    return dc->process_interruption(dc);
+}
+#endif
+
+// Yields the signature of the current input, followed by the sighash byte if append_sighash_byte is
+// true. If signatures are packed, the signature is added to the buffer instead, after yielding the
+// signatures already in the buffer if there is not enough space left; on NanoS, there is no buffer,
+// and the packed signature is yielded immediately.
+static int yield_signature(dispatcher_context_t *dc,
+                           sign_psbt_state_t *state,
+                           const uint8_t *sig,
+                           size_t sig_len,
+                           bool append_sighash_byte) {
+    uint8_t sighash_byte = (uint8_t) (state->cur_input.sighash_type & 0xFF);
+
+    // Each packed signature is serialized as <input_index : var> <len : 1> <signature : len>
+    size_t full_sig_len = sig_len + (append_sighash_byte ? 1 : 0);
+
+#ifdef TARGET_NANOS
+    bool buffered = false;
+#else
+    bool buffered = state->pack_signatures;
+#endif
+
+    if (!buffered) {
+        buffer_t *response = dc->get_response_buffer();
+        buffer_write_u8(response, CCMD_YIELD);
+        buffer_write_varint(response, state->cur_input_index);
+        if (state->pack_signatures) {
+            buffer_write_u8(response, (uint8_t) full_sig_len);
+        }
+        buffer_write_bytes(response, sig, sig_len);
+        if (append_sighash_byte) {
+            buffer_write_u8(response, sighash_byte);
+        }
+        dc->finalize_response(SW_INTERRUPTED_EXECUTION);
+
+        return dc->process_interruption(dc);
+    }
+
+#ifndef TARGET_NANOS
+    size_t record_len = varint_size(state->cur_input_index) + 1 + full_sig_len;
+
+    if (state->packed_signatures_len + record_len > sizeof(state->packed_signatures)) {
+        if (yield_packed_signatures(dc, state) < 0) {
+            return -1;
+        }
+    }
+
+    uint8_t *out = state->packed_signatures + state->packed_signatures_len;
+    int index_len = varint_write(out, 0, state->cur_input_index);
+    out[index_len] = (uint8_t) full_sig_len;
+    memcpy(out + index_len + 1, sig, sig_len);
+    if (append_sighash_byte) {
+        out[index_len + 1 + sig_len] = sighash_byte;
+    }
+    state->packed_signatures_len += record_len;
+#endif
+    return 0;
+}
+
 // Common for legacy and segwitv0 transactions
 static void sign_sighash_ecdsa(dispatcher_context_t *dc) {
     sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    uint32_t sign_path[MAX_BIP32_PATH_STEPS];
-    for (int i = 0; i < state->our_key_derivation_length; i++) {
-        sign_path[i] = state->our_key_derivation[i];
-    }
-    sign_path[state->our_key_derivation_length] = state->cur_input.change;
-    sign_path[state->our_key_derivation_length + 1] = state->cur_input.address_index;
-
-    int sign_path_len = state->our_key_derivation_length + 2;
+    cx_ecfp_private_key_t private_key = {0};
 
     uint8_t sig[MAX_DER_SIG_LEN];
+    int sig_len = 0;
 
-    int sig_len =
-        crypto_ecdsa_sign_sha256_hash_with_key(sign_path, sign_path_len, state->sighash, sig, NULL);
-    if (sig_len < 0) {
+    bool error = false;
+    BEGIN_TRY {
+        TRY {
+            if (derive_input_private_key(state, &private_key) < 0) {
+                error = true;
+            } else {
+                uint32_t info;
+                sig_len = cx_ecdsa_sign(&private_key,
+                                        CX_RND_RFC6979,
+                                        CX_SHA256,
+                                        state->sighash,
+                                        32,
+                                        sig,
+                                        MAX_DER_SIG_LEN,
+                                        &info);
+            }
+        }
+        CATCH_ALL {
+            error = true;
+        }
+        FINALLY {
+            explicit_bzero(&private_key, sizeof(private_key));
+        }
+    }
+    END_TRY;
+
+    if (error || sig_len <= 0) {
         // unexpected error when signing
         SEND_SW(dc, SW_BAD_STATE);
         return;
     }
 
-    // yield signature
-    uint8_t cmd = CCMD_YIELD;
-    dc->add_to_response(&cmd, 1);
-    uint8_t input_index = (uint8_t) state->cur_input_index;
-    dc->add_to_response(&input_index, 1);
-    dc->add_to_response(&sig, sig_len);
-    uint8_t sighash_byte = (uint8_t) (state->cur_input.sighash_type & 0xFF);
-    dc->add_to_response(&sighash_byte, 1);
-    dc->finalize_response(SW_INTERRUPTED_EXECUTION);
-
-    if (dc->process_interruption(dc) < 0) {
+    if (yield_signature(dc, state, sig, sig_len, true) < 0) {
         SEND_SW(dc, SW_BAD_STATE);
         return;
     }
@@ -2010,35 +2162,26 @@ static void sign_sighash_schnorr(dispatcher_context_t *dc) {
     cx_ecfp_private_key_t private_key = {0};
     uint8_t *seckey = private_key.d;  // convenience alias (entirely within the private_key struct)
 
-    uint8_t chain_code[32] = {0};
-
-    uint32_t sign_path[MAX_BIP32_PATH_STEPS];
-    for (int i = 0; i < state->our_key_derivation_length; i++) {
-        sign_path[i] = state->our_key_derivation[i];
-    }
-    sign_path[state->our_key_derivation_length] = state->cur_input.change;
-    sign_path[state->our_key_derivation_length + 1] = state->cur_input.address_index;
-
-    int sign_path_len = state->our_key_derivation_length + 2;
-
     uint8_t sig[64];
     size_t sig_len;
 
     bool error = false;
     BEGIN_TRY {
         TRY {
-            crypto_derive_private_key(&private_key, chain_code, sign_path, sign_path_len);
-            crypto_tr_tweak_seckey(seckey);
-
-            unsigned int err = cx_ecschnorr_sign_no_throw(&private_key,
-                                                          CX_ECSCHNORR_BIP0340 | CX_RND_TRNG,
-                                                          CX_SHA256,
-                                                          state->sighash,
-                                                          32,
-                                                          sig,
-                                                          &sig_len);
-            if (err != CX_OK) {
+            if (derive_input_private_key(state, &private_key) < 0 ||
+                crypto_tr_tweak_seckey(seckey) < 0) {
                 error = true;
+            } else {
+                unsigned int err = cx_ecschnorr_sign_no_throw(&private_key,
+                                                              CX_ECSCHNORR_BIP0340 | CX_RND_TRNG,
+                                                              CX_SHA256,
+                                                              state->sighash,
+                                                              32,
+                                                              sig,
+                                                              &sig_len);
+                if (err != CX_OK) {
+                    error = true;
+                }
             }
         }
         CATCH_ALL {
@@ -2062,22 +2205,9 @@ static void sign_sighash_schnorr(dispatcher_context_t *dc) {
         return;
     }
 
-    // yield signature
-    uint8_t cmd = CCMD_YIELD;
-    dc->add_to_response(&cmd, 1);
-    uint8_t input_index = (uint8_t) state->cur_input_index;
-    dc->add_to_response(&input_index, 1);
-    dc->add_to_response(&sig, sizeof(sig));
-
     // only append the sighash type byte if it is non-zero
-    uint8_t sighash_byte = (uint8_t) (state->cur_input.sighash_type & 0xFF);
-    if (sighash_byte != 0x00) {
-        // only add the sighash byte if not 0
-        dc->add_to_response(&sighash_byte, 1);
-    }
-    dc->finalize_response(SW_INTERRUPTED_EXECUTION);
-
-    if (dc->process_interruption(dc) < 0) {
+    bool append_sighash_byte = (state->cur_input.sighash_type & 0xFF) != 0x00;
+    if (yield_signature(dc, state, sig, sizeof(sig), append_sighash_byte) < 0) {
         SEND_SW(dc, SW_BAD_STATE);
         return;
     }
@@ -2089,5 +2219,15 @@ static void sign_sighash_schnorr(dispatcher_context_t *dc) {
 static void finalize(dispatcher_context_t *dc) {
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
+#ifndef TARGET_NANOS
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    // yield any signatures that are still in the buffer
+    if (state->packed_signatures_len > 0 && yield_packed_signatures(dc, state) < 0) {
+        SEND_SW(dc, SW_BAD_STATE);
+        return;
+    }
+#endif
+
     SEND_SW(dc, SW_OK);
 }
\ No newline at end of file
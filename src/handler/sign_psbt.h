@@ -1,10 +1,58 @@
 #pragma once
 
 #include "../boilerplate/dispatcher.h"
+#include "../common/bitvector.h"
 #include "../common/merkle.h"
 
-#define MAX_N_INPUTS_CAN_SIGN  64
-#define MAX_N_OUTPUTS_CAN_SIGN 256
+// The information recorded for each input takes INPUT_INFO_N_BITS bits; this keeps the memory used
+// for all the inputs at 64 bytes.
+#define MAX_N_INPUTS_CAN_SIGN 128
+// Outputs are verified one at a time, keeping only running totals and counters; therefore, the
+// memory used does not depend on the number of outputs, and this limit only bounds the time spent
+// in the output verification.
+#define MAX_N_OUTPUTS_CAN_SIGN 10000
+
+// Sizes of the caches used to avoid requesting the same data multiple times while computing the
+// sighash of each input. Inputs/outputs that do not fit in the caches are fetched from the client.
+// Except on NanoS, the outpoints of all the inputs that can be signed are cached (40 bytes each).
+// Known limitation: on NanoS, there is only room for the first N_CACHED_INPUTS outpoints; for
+// transactions with more inputs, the outpoints of the remaining ones are requested again for each
+// legacy input signed, so the number of client requests is quadratic in the number of inputs.
+// The serialized outputs are not cached on NanoS: they are requested again for each legacy input.
+#ifdef TARGET_NANOS
+#define N_CACHED_INPUTS 4
+#else
+#define N_CACHED_INPUTS           MAX_N_INPUTS_CAN_SIGN
+#define MAX_CACHED_OUTPUTS_LENGTH 1024
+#endif
+
+// Flags in the P2 of the SIGN_PSBT apdu.
+// If set, the signatures are packed in as few YIELD client commands as possible, instead of using
+// one YIELD per signature.
+#define SIGN_PSBT_P2_PACK_SIGNATURES 0x01
+
+// Maximum length of the packed signatures in a single YIELD (excluding the CCMD_YIELD byte). On
+// NanoS, signatures are not buffered: each one is yielded as soon as it is computed, still using
+// the packed encoding.
+#ifndef TARGET_NANOS
+#define MAX_PACKED_SIGNATURES_LEN 254
+#endif
+
+// The part of an input's network serialization (excluding the scriptSig) used in the sighash
+typedef struct {
+    uint8_t prevout_hash[32];
+    uint8_t prevout_n[4];
+    uint8_t nSequence[4];
+} input_outpoint_t;
+
+// Bits of the information recorded for each input in inputs_info, collected while the inputs are
+// verified and used when signing them. Except for INPUT_INFO_INTERNAL, they are only set for
+// internal inputs. The sighash type is not recorded, as only SIGHASH_ALL is supported.
+#define INPUT_INFO_INTERNAL          0  // the input is internal
+#define INPUT_INFO_HAS_WITNESS_UTXO  1  // the input is signed as a segwit input
+#define INPUT_INFO_HAS_REDEEM_SCRIPT 2
+#define INPUT_INFO_SEGWIT_V1         3  // segwit input without redeemScript, with a v1 scriptPubKey
+#define INPUT_INFO_N_BITS            4
 
 typedef struct {
     merkleized_map_commitment_t map;
@@ -84,7 +132,8 @@ typedef struct {
 
     uint32_t master_key_fingerprint;
 
-    uint8_t internal_inputs[MAX_N_INPUTS_CAN_SIGN];  // TODO: use a bitvector
+    uint8_t inputs_info[BITVECTOR_REAL_SIZE(MAX_N_INPUTS_CAN_SIGN * INPUT_INFO_N_BITS)];
+    bool has_segwit_inputs_to_sign;  // true if at least one internal input is signed as segwit
 
     union {
         struct {
@@ -94,11 +143,27 @@ typedef struct {
         struct {
             unsigned int cur_output_index;
             cur_output_info_t cur_output;
+
+            // single SHA-256 of the serialization of the outputs, computed while they are verified
+            cx_sha256_t sha_outputs_context;
         };
     };
 
     uint8_t sighash[32];
 
+    // cache of the outpoint and nSequence of the first n_cached_inputs inputs
+    input_outpoint_t cached_inputs[N_CACHED_INPUTS];
+    unsigned int n_cached_inputs;
+
+#ifndef TARGET_NANOS
+    // cache of the network serialization of all the outputs, if it fits
+    struct {
+        bool is_valid;
+        size_t length;
+        uint8_t data[MAX_CACHED_OUTPUTS_LENGTH];
+    } cached_outputs;
+#endif
+
     struct {
         uint8_t sha_prevouts[32];
         uint8_t sha_amounts[32];
@@ -119,6 +184,20 @@ typedef struct {
 
     int our_key_derivation_length;
     uint32_t our_key_derivation[MAX_BIP32_PATH_STEPS];
+
+    // Private key and chain code at our_key_derivation, derived once before signing the inputs.
+    // Like the rest of the state, they are wiped by the dispatcher at the end of the command, and
+    // when the IO is reset (for example, after a timeout while waiting for a client response).
+    uint8_t our_privkey[32];
+    uint8_t our_chain_code[32];
+
+    // if true, the signatures are yielded with the packed encoding and, except on NanoS, buffered in
+    // packed_signatures and yielded together
+    bool pack_signatures;
+#ifndef TARGET_NANOS
+    size_t packed_signatures_len;
+    uint8_t packed_signatures[MAX_PACKED_SIGNATURES_LEN];
+#endif
 } sign_psbt_state_t;
 
 void handler_sign_psbt(dispatcher_context_t *dispatcher_context);
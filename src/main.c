@@ -32,6 +32,10 @@
 #include "boilerplate/dispatcher.h"
 
 #include "commands.h"
+#include "crypto.h"
+#include "handler/lib/get_merkle_leaf_hash.h"
+#include "handler/lib/get_merkleized_map.h"
+#include "handler/lib/policy.h"
 
 #include "legacy/main_old.h"
 #include "legacy/btchip_display_variables.h"
@@ -187,12 +191,16 @@ void app_main() {
             app_dispatch();
 
             if (btchip_context_D.called_from_swap && vars.swap_data.should_exit) {
+                crypto_pubkeys_cache_reset();
                 os_sched_exit(0);
             }
         } else {
             if (G_app_mode != APP_MODE_NEW) {
                 explicit_bzero(&G_command_state, sizeof(G_command_state));
 
+                // on NanoS, the cache shares its memory with the globals of the legacy app
+                crypto_pubkeys_cache_reset();
+
                 G_app_mode = APP_MODE_NEW;
             }
 
@@ -216,6 +224,13 @@ void app_main() {
             }
             PRINTF("\n");
 
+            if (cmd.cla != CLA_FRAMEWORK || cmd.ins != INS_CONTINUE) {
+                // a new command is starting, forget the data verified in previous ones
+                merkle_cache_reset();
+                verified_maps_reset();
+                policy_keys_cache_reset();
+            }
+
             // Dispatch structured APDU command to handler
             apdu_dispatcher(COMMAND_DESCRIPTORS,
                             sizeof(COMMAND_DESCRIPTORS) / sizeof(COMMAND_DESCRIPTORS[0]),
@@ -231,6 +246,9 @@ void app_main() {
  * Exit the application and go back to the dashboard.
  */
 void app_exit() {
+    // the cached keys must not outlive the app
+    crypto_pubkeys_cache_reset();
+
     BEGIN_TRY_L(exit) {
         TRY_L(exit) {
             os_sched_exit(-1);
@@ -272,6 +290,9 @@ void coin_main(btchip_altcoin_config_t *coin_config) {
     // Reset dispatcher state
     explicit_bzero(&G_dispatcher_context, sizeof(G_dispatcher_context));
 
+    // Reset the cache of the keys derived from the seed
+    crypto_pubkeys_cache_reset();
+
     memset(G_io_apdu_buffer, 0, 255);  // paranoia
 
     // Process the incoming APDUs
@@ -300,6 +321,10 @@ void coin_main(btchip_altcoin_config_t *coin_config) {
                 app_main();
             }
             CATCH(EXCEPTION_IO_RESET) {
+                // the command in progress (if any) is abandoned: wipe its state, as it might
+                // contain secrets
+                explicit_bzero(&G_command_state, sizeof(G_command_state));
+
                 // reset IO and UX
                 CLOSE_TRY;
                 continue;
@@ -52,6 +52,9 @@ def pytest_addoption(parser):
     parser.addoption("--hid", action="store_true")
     parser.addoption("--headless", action="store_true")
     parser.addoption("--enableslowtests", action="store_true")
+    parser.addoption("--benchmark", action="store_true")
+    parser.addoption("--benchmark-baseline", action="store", default=None)
+    parser.addoption("--update-benchmark-baseline", action="store_true")
 
 
 @pytest.fixture(scope="module")
@@ -93,6 +96,11 @@ def enable_slow_tests(pytestconfig):
     return pytestconfig.getoption("enableslowtests")
 
 
+@pytest.fixture
+def enable_benchmarks(pytestconfig):
+    return pytestconfig.getoption("benchmark")
+
+
 @pytest.fixture(scope='session', autouse=True)
 def root_directory(request):
     return Path(str(request.config.rootdir))
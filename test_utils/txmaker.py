@@ -1,6 +1,6 @@
 from random import randint
 
-from typing import List, Tuple
+from typing import List, Optional, Tuple
 from bitcoin_client.ledger_bitcoin import PolicyMapWallet
 from bitcoin_client.ledger_bitcoin.key import KeyOriginInfo, parse_path
 from bitcoin_client.ledger_bitcoin.psbt import PSBT, PartiallySignedInput, PartiallySignedOutput
@@ -9,11 +9,6 @@ from bitcoin_client.ledger_bitcoin.tx import CScriptWitness, CTransaction, CTxIn
 from embit.descriptor import Descriptor
 from embit.script import Script
 from embit.bip32 import HDKey
-from embit.bip39 import mnemonic_to_seed
-
-SPECULOS_SEED = "glory promote mansion idle axis finger extra february uncover one trip resource lawn turtle enact monster seven myth punch hobby comfort wild raise skin"
-master_key = HDKey.from_seed(mnemonic_to_seed(SPECULOS_SEED))
-master_key_fpr = master_key.derive("m/0'").fingerprint
 
 
 def random_numbers_with_sum(n: int, s: int) -> List[int]:
@@ -38,7 +33,7 @@ def random_txid() -> bytes:
     return random_bytes(32)
 
 
-def getScriptPubkeyFromWallet(wallet: PolicyMapWallet, change: bool, address_index: int) -> Script:
+def getDescriptorFromWallet(wallet: PolicyMapWallet, change: bool, address_index: int) -> Descriptor:
     descriptor_str = wallet.policy_map
 
     # Iterate in reverse order, as strings identifying a small-index key (like @1) can be a
@@ -55,7 +50,32 @@ def getScriptPubkeyFromWallet(wallet: PolicyMapWallet, change: bool, address_ind
 
         descriptor_str = descriptor_str.replace(f"@{i}", key_info_str)
 
-    return Descriptor.from_string(descriptor_str).derive(address_index).script_pubkey()
+    return Descriptor.from_string(descriptor_str).derive(address_index)
+
+
+def getScriptPubkeyFromWallet(wallet: PolicyMapWallet, change: bool, address_index: int) -> Script:
+    return getDescriptorFromWallet(wallet, change, address_index).script_pubkey()
+
+
+def getKeyPathsFromWallet(wallet: PolicyMapWallet, change: bool, address_index: int) -> List[Tuple[bytes, KeyOriginInfo]]:
+    """
+    Returns the list of the pubkeys (in compressed form), with their key origin info, of all the keys of the wallet
+    at the given change/address_index.
+    """
+    result: List[Tuple[bytes, KeyOriginInfo]] = []
+    for key_info_str in wallet.keys_info:
+        # key_info_str is of the form "[fpr/path]xpub/**"
+        key_origin = key_info_str[1:key_info_str.index("]")]
+        xpub = key_info_str[key_info_str.index("]") + 1:-3]
+
+        fpr = bytes.fromhex(key_origin[:8])
+        path = parse_path(f"m{key_origin[8:]}/{1 if change else 0}/{address_index}")
+        pubkey: bytes = HDKey.from_string(xpub).derive([1 if change else 0, address_index]).key.sec()
+
+        assert len(pubkey) == 33
+
+        result.append((pubkey, KeyOriginInfo(fpr, path)))
+    return result
 
 
 def createFakeWalletTransaction(n_inputs: int, n_outputs: int, output_amount: int, wallet: PolicyMapWallet) -> Tuple[CTransaction, int, int, int]:
@@ -111,15 +131,23 @@ def createFakeWalletTransaction(n_inputs: int, n_outputs: int, output_amount: in
     return tx, selected_output_index, selected_output_change, selected_output_address_index
 
 
-def createPsbt(wallet: PolicyMapWallet, input_amounts: List[int], output_amounts: List[int], output_is_change: List[bool]) -> PSBT:
+def createPsbt(wallet: PolicyMapWallet, input_amounts: List[int], output_amounts: List[int], output_is_change: List[bool],
+               prevout_n_inputs: Optional[int] = None, prevout_n_outputs: Optional[int] = None) -> PSBT:
+    """
+    Creates a PSBT spending inputs of the given amounts from the wallet, with the given outputs.
+    Supported wallets are the single-key pkh, wpkh, sh(wpkh) and tr ones, and wsh multisig.
+
+    Each input spends an output of a fake prevout transaction (used as non-witness UTXO); the number of its inputs and
+    outputs, that determine its size, is prevout_n_inputs and prevout_n_outputs respectively, or random if omitted.
+    """
     assert len(output_amounts) == len(output_is_change)
     assert sum(output_amounts) <= sum(input_amounts)
 
-    # TODO: add support for wrapped segwit wallets
+    is_multisig = wallet.policy_map.startswith("wsh(sortedmulti(") or wallet.policy_map.startswith("wsh(multi(")
 
-    if wallet.n_keys != 1:
-        raise NotImplementedError("Only 1-key wallets supported")
-    if wallet.policy_map not in ["pkh(@0)", "wpkh(@0)", "tr(@0)"]:
+    if wallet.n_keys != 1 and not is_multisig:
+        raise NotImplementedError("Only 1-key wallets and wsh multisig wallets supported")
+    if wallet.policy_map not in ["pkh(@0)", "wpkh(@0)", "sh(wpkh(@0))", "tr(@0)"] and not is_multisig:
         raise NotImplementedError("Unsupported policy type")
 
     vin: List[CTxIn] = [CTxIn() for _ in input_amounts]
@@ -131,8 +159,8 @@ def createPsbt(wallet: PolicyMapWallet, input_amounts: List[int], output_amounts
     prevout_path_change: List[int] = []
     prevout_path_addr_idx: List[int] = []
     for i, prevout_amount in enumerate(input_amounts):
-        n_inputs = randint(1, 10)
-        n_outputs = randint(1, 10)
+        n_inputs = randint(1, 10) if prevout_n_inputs is None else prevout_n_inputs
+        n_outputs = randint(1, 10) if prevout_n_outputs is None else prevout_n_outputs
         prevout, idx, is_change, addr_idx = createFakeWalletTransaction(n_inputs, n_outputs, prevout_amount, wallet)
         prevouts.append(prevout)
         prevout_ns.append(idx)
@@ -155,12 +183,11 @@ def createPsbt(wallet: PolicyMapWallet, input_amounts: List[int], output_amounts
     psbt.outputs = [PartiallySignedOutput() for _ in output_amounts]
 
     # simplification; good enough for the scripts we support now, but will need more work
-    is_legacy = "pkh("
-    is_segwitv0 = wallet.policy_map.startswith("wpkh(") or wallet.policy_map.startswith("sh(wpkh(")
+    is_legacy = wallet.policy_map.startswith("pkh(")
+    is_wrapped_segwit = wallet.policy_map.startswith("sh(wpkh(")
+    is_segwitv0 = wallet.policy_map.startswith("wpkh(") or is_wrapped_segwit or is_multisig
     is_taproot = wallet.policy_map.startswith("tr(")
 
-    key_origin = wallet.keys_info[0][1:wallet.keys_info[0].index("]")]
-
     for i in range(len(input_amounts)):
         if is_legacy or is_segwitv0:
             # add non-witness UTXO
@@ -169,19 +196,20 @@ def createPsbt(wallet: PolicyMapWallet, input_amounts: List[int], output_amounts
             # add witness UTXO
             psbt.inputs[i].witness_utxo = prevouts[i].vout[prevout_ns[i]]
 
-        path_str = f"m{key_origin[8:]}/{prevout_path_change[i]}/{prevout_path_addr_idx[i]}"
-        path = parse_path(path_str)
-        input_key: bytes = master_key.derive(path_str).key.sec()
-
-        assert len(input_key) == 33
+        descriptor = getDescriptorFromWallet(wallet, prevout_path_change[i], prevout_path_addr_idx[i])
+        if is_wrapped_segwit:
+            psbt.inputs[i].redeem_script = descriptor.redeem_script().data
+        elif is_multisig:
+            psbt.inputs[i].witness_script = descriptor.witness_script().data
 
         # add key and path info
-        if is_legacy or is_segwitv0:
-            psbt.inputs[i].hd_keypaths[input_key] = KeyOriginInfo(master_key_fpr, path)
-        elif is_taproot:
-            psbt.inputs[i].tap_hd_keypaths[input_key[1:]] = (list(), KeyOriginInfo(master_key_fpr, path))
-        else:
-            raise RuntimeError("Unexpected state: unknown transaction type")
+        for input_key, origin in getKeyPathsFromWallet(wallet, prevout_path_change[i], prevout_path_addr_idx[i]):
+            if is_legacy or is_segwitv0:
+                psbt.inputs[i].hd_keypaths[input_key] = origin
+            elif is_taproot:
+                psbt.inputs[i].tap_hd_keypaths[input_key[1:]] = (list(), origin)
+            else:
+                raise RuntimeError("Unexpected state: unknown transaction type")
 
     for i, output_amount in enumerate(output_amounts):
         # TODO: we could use a completely different script/wallet for non-change outputs
@@ -193,15 +221,18 @@ def createPsbt(wallet: PolicyMapWallet, input_amounts: List[int], output_amounts
         tx.vout[i].nValue = output_amount
 
         if output_is_change[i]:
-            path_str = f"m{key_origin[8:]}/1/{i}"
-            path = parse_path(path_str)
-            output_key: bytes = master_key.derive(path_str).key.sec()
+            descriptor = getDescriptorFromWallet(wallet, True, i)
+            if is_wrapped_segwit:
+                psbt.outputs[i].redeem_script = descriptor.redeem_script().data
+            elif is_multisig:
+                psbt.outputs[i].witness_script = descriptor.witness_script().data
 
             # add key and path information for change output
-            if is_legacy or is_segwitv0:
-                psbt.outputs[i].hd_keypaths[output_key] = KeyOriginInfo(master_key_fpr, path)
-            elif is_taproot:
-                psbt.outputs[i].tap_hd_keypaths[output_key[1:]] = (list(), KeyOriginInfo(master_key_fpr, path))
+            for output_key, origin in getKeyPathsFromWallet(wallet, True, i):
+                if is_legacy or is_segwitv0:
+                    psbt.outputs[i].hd_keypaths[output_key] = origin
+                elif is_taproot:
+                    psbt.outputs[i].tap_hd_keypaths[output_key[1:]] = (list(), origin)
 
     psbt.tx = tx
 
@@ -0,0 +1,268 @@
+"""
+Benchmarks of the sign_psbt command.
+
+For each scenario, a PSBT is generated with txmaker (varying the number of inputs and outputs, the script type and the
+size of the non-witness UTXOs), and signed on the device; the number of APDUs, the bytes exchanged in each direction
+and the wall-clock time are recorded, and compared with the ones in the baseline file, failing if any of them exceeds
+the baseline by more than the configured threshold.
+
+Benchmarks only run with the --benchmark option; the scenarios with many inputs or outputs also need --enableslowtests.
+Scenarios with more inputs than the app can sign (MAX_N_INPUTS_CAN_SIGN in src/handler/sign_psbt.h) are skipped.
+The baseline file is tests/benchmarks/sign_psbt_baseline.json, or the one given with --benchmark-baseline; if
+--update-benchmark-baseline is given, the results are written to the baseline file at the end of the session instead
+of being compared.
+"""
+
+import pytest
+
+import json
+import random
+import re
+import time
+
+from pathlib import Path
+from typing import Dict, List, Optional, Tuple, Union
+
+from bitcoin_client.ledger_bitcoin import Chain, PolicyMapWallet, MultisigWallet, AddressType, TransportClient, createClient
+from bitcoin_client.ledger_bitcoin.client_base import ApduException
+from bitcoin_client.ledger_bitcoin.exception import DeviceException
+from speculos.client import SpeculosClient
+
+from test_utils import automation, txmaker
+
+tests_root: Path = Path(__file__).parent
+
+DEFAULT_BASELINE_PATH = tests_root / "benchmarks" / "sign_psbt_baseline.json"
+
+# Scenarios with more inputs or outputs than this only run with --enableslowtests
+SLOW_SCENARIO_SIZE = 50
+
+
+def get_max_n_inputs_can_sign() -> int:
+    """Returns the maximum number of inputs of a psbt that the app can sign; if it depends on the device model, the
+    smallest one."""
+
+    sign_psbt_h = (tests_root.parent / "src" / "handler" / "sign_psbt.h").read_text()
+    values = re.findall(r"#define\s+MAX_N_INPUTS_CAN_SIGN\s+(\d+)", sign_psbt_h)
+    if len(values) == 0:
+        raise ValueError("MAX_N_INPUTS_CAN_SIGN not found in sign_psbt.h")
+    return min(int(v) for v in values)
+
+
+MAX_N_INPUTS_CAN_SIGN = get_max_n_inputs_can_sign()
+
+WALLETS: Dict[str, Tuple[PolicyMapWallet, Optional[bytes]]] = {
+    "pkh": (
+        PolicyMapWallet(
+            "",
+            "pkh(@0)",
+            [
+                "[f5acc2fd/44'/1'/0']tpubDCwYjpDhUdPGP5rS3wgNg13mTrrjBuG8V9VpWbyptX6TRPbNoZVXsoVUSkCjmQ8jJycjuDKBb9eataSymXakTTaGifxR6kmVsfFehH1ZgJT/**"
+            ],
+        ),
+        None
+    ),
+    "wpkh": (
+        PolicyMapWallet(
+            "",
+            "wpkh(@0)",
+            [
+                "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+            ],
+        ),
+        None
+    ),
+    "sh-wpkh": (
+        PolicyMapWallet(
+            "",
+            "sh(wpkh(@0))",
+            [
+                "[f5acc2fd/49'/1'/0']tpubDC871vGLAiKPcwAw22EjhKVLk5L98UGXBEcGR8gpcigLQVDDfgcYW24QBEyTHTSFEjgJgbaHU8CdRi9vmG4cPm1kPLmZhJEP17FMBdNheh3/**"
+            ],
+        ),
+        None
+    ),
+    "tr": (
+        PolicyMapWallet(
+            "",
+            "tr(@0)",
+            [
+                "[f5acc2fd/86'/1'/0']tpubDDKYE6BREvDsSWMazgHoyQWiJwYaDDYPbCFjYxN3HFXJP5fokeiK4hwK5tTLBNEDBwrDXn8cQ4v9b2xdW62Xr5yxoQdMu1v6c7UDXYVH27U/**"
+            ],
+        ),
+        None
+    ),
+    "wsh-multisig": (
+        MultisigWallet(
+            name="Cold storage",
+            address_type=AddressType.WIT,
+            threshold=2,
+            keys_info=[
+                "[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+                "[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+            ],
+        ),
+        bytes.fromhex("d6434852fb3caa7edbd1165084968f1691444b3cfc10cf1e431acbbc7f48451f")
+    ),
+}
+
+
+def make_scenarios() -> Dict[str, dict]:
+    """Returns the scenarios, by name. Each sweep varies one parameter, keeping the others as in the base scenario."""
+
+    base = {"script_type": "wpkh", "n_inputs": 2, "n_outputs": 2, "prevout_n_inputs": 2}
+
+    scenarios: List[dict] = []
+    scenarios += [{**base, "n_inputs": n} for n in [1, 2, 5, 10, 25, 50, 100, 128]]
+    scenarios += [{**base, "n_outputs": n} for n in [1, 2, 5, 10, 25, 50, 100, 250, 500]]
+    scenarios += [{**base, "script_type": t} for t in WALLETS.keys()]
+    # the non-witness UTXO is the only UTXO for legacy inputs
+    scenarios += [{**base, "script_type": "pkh", "prevout_n_inputs": n} for n in [1, 10, 50, 100]]
+
+    return {
+        f"{s['script_type']}_{s['n_inputs']}in_{s['n_outputs']}out_prevout{s['prevout_n_inputs']}in": s
+        for s in scenarios
+    }
+
+
+SCENARIOS = make_scenarios()
+
+
+class CountingTransport:
+    """Wraps a transport client, counting the APDUs exchanged and their size (including header and status word)."""
+
+    def __init__(self, transport: Union[TransportClient, SpeculosClient]):
+        self.transport = transport
+        self.reset()
+
+    def reset(self) -> None:
+        self.n_apdus = 0
+        self.bytes_sent = 0
+        self.bytes_received = 0
+
+    def apdu_exchange(self, cla: int, ins: int, data: bytes = b"", p1: int = 0, p2: int = 0) -> bytes:
+        self.n_apdus += 1
+        self.bytes_sent += 5 + len(data)
+        try:
+            response = self.transport.apdu_exchange(cla, ins, data, p1, p2)
+        except ApduException as e:
+            self.bytes_received += len(e.data) + 2
+            raise
+        self.bytes_received += len(response) + 2
+        return response
+
+    def __getattr__(self, name):
+        return getattr(self.transport, name)
+
+
+@pytest.fixture(scope="session")
+def benchmark_baseline(pytestconfig):
+    """Loads the baseline; at the end of the session, writes the new results to it if requested."""
+
+    path = Path(pytestconfig.getoption("benchmark_baseline") or DEFAULT_BASELINE_PATH)
+    baseline = json.loads(path.read_text()) if path.is_file() else {"thresholds": {}, "scenarios": {}}
+
+    results: Dict[str, dict] = {}
+    yield baseline, results
+
+    if pytestconfig.getoption("update_benchmark_baseline") and len(results) > 0:
+        baseline["scenarios"] = {**baseline["scenarios"], **results}
+        baseline["scenarios"] = dict(sorted(baseline["scenarios"].items()))
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(json.dumps(baseline, indent=2) + "\n")
+
+
+def create_psbt(scenario: dict):
+    wallet, _ = WALLETS[scenario["script_type"]]
+    n_inputs = scenario["n_inputs"]
+    n_outputs = scenario["n_outputs"]
+
+    in_amounts = [1_000_000 + 1000 * i for i in range(n_inputs)]
+    out_amounts = [(sum(in_amounts) - 10_000) // n_outputs] * n_outputs
+    # the first output is a change output, unless it's the only one
+    out_is_change = [i == 0 and n_outputs > 1 for i in range(n_outputs)]
+
+    return txmaker.createPsbt(
+        wallet,
+        in_amounts,
+        out_amounts,
+        out_is_change,
+        prevout_n_inputs=scenario["prevout_n_inputs"],
+        prevout_n_outputs=2
+    )
+
+
+def check_regressions(name: str, measured: dict, baseline: dict) -> List[str]:
+    """Returns the descriptions of the metrics exceeding the baseline by more than their threshold."""
+
+    base = baseline["scenarios"].get(name)
+    if base is None:
+        return []
+
+    thresholds = {**baseline["thresholds"], **base.get("thresholds", {})}
+    regressions: List[str] = []
+    for metric, threshold in thresholds.items():
+        if metric not in measured or metric not in base:
+            continue
+        limit = base[metric] * (1 + threshold)
+        if measured[metric] > limit:
+            regressions.append(f"{metric}: {measured[metric]} > {base[metric]} (+{threshold:.0%})")
+    return regressions
+
+
+@automation("automations/sign_with_wallet_accept.json")
+@pytest.mark.parametrize("name", SCENARIOS.keys())
+def test_benchmark_sign_psbt(name: str, comm, benchmark_baseline, pytestconfig, enable_benchmarks: bool,
+                             enable_slow_tests: bool):
+    if not enable_benchmarks:
+        pytest.skip("Benchmarks only run with --benchmark")
+
+    scenario = SCENARIOS[name]
+    if scenario["n_inputs"] > MAX_N_INPUTS_CAN_SIGN:
+        pytest.skip(f"The app can sign at most {MAX_N_INPUTS_CAN_SIGN} inputs")
+    if max(scenario["n_inputs"], scenario["n_outputs"]) > SLOW_SCENARIO_SIZE and not enable_slow_tests:
+        pytest.skip("Slow benchmark, only runs with --enableslowtests")
+
+    baseline, results = benchmark_baseline
+
+    # each scenario generates the same PSBT, regardless of which other scenarios run
+    random.seed(name)
+    psbt = create_psbt(scenario)
+    wallet, wallet_hmac = WALLETS[scenario["script_type"]]
+
+    transport = CountingTransport(comm)
+    client = createClient(transport, chain=Chain.TEST, debug=False)
+
+    transport.reset()
+    start = time.perf_counter()
+    result = client.sign_psbt(psbt, wallet, wallet_hmac)
+    elapsed = time.perf_counter() - start
+
+    assert len(result) == scenario["n_inputs"]
+
+    measured = {
+        "n_apdus": transport.n_apdus,
+        "bytes_sent": transport.bytes_sent,
+        "bytes_received": transport.bytes_received,
+        "time_s": round(elapsed, 3),
+    }
+
+    # the device's counters are only available if the app is compiled with COMMAND_STATS=1
+    try:
+        stats = client.get_command_stats()
+        measured["merkle_combine_hashes"] = stats["merkle_combine_hashes"]
+        measured["bip32_derivations"] = stats["bip32_derivations"]
+    except DeviceException:
+        pass
+
+    print(f"{name}: {measured}")
+    results[name] = measured
+
+    if pytestconfig.getoption("update_benchmark_baseline"):
+        return
+
+    if name not in baseline["scenarios"]:
+        print(f"{name}: not in the baseline")
+
+    regressions = check_regressions(name, measured, baseline)
+    assert len(regressions) == 0, f"Regressions in {name}: " + ", ".join(regressions)
@@ -9,6 +9,7 @@ from typing import List
 from pathlib import Path
 
 from bitcoin_client.ledger_bitcoin import Client, PolicyMapWallet, MultisigWallet, AddressType
+from bitcoin_client.ledger_bitcoin.client import NewClient
 from bitcoin_client.ledger_bitcoin.exception.errors import IncorrectDataError, NotSupportedError
 
 from bitcoin_client.ledger_bitcoin.psbt import PSBT
@@ -231,6 +232,56 @@ def test_sign_psbt_singlesig_wpkh_2to2(client: Client):
     }
 
 
+@automation("automations/sign_with_wallet_accept.json")
+def test_sign_psbt_singlesig_wpkh_2to2_legacy_client(client: Client, comm: SpeculosClient):
+    # Same as test_sign_psbt_singlesig_wpkh_2to2, with a client for versions of the app before 2.1.0.
+    # Neither the extended client commands nor PACK_SIGNATURES are used, and each signature is
+    # returned in its own YIELD
+
+    psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/wpkh-2to2.psbt")
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    legacy_client = NewClient(comm, client.chain, debug=True, app_version="2.0.2")
+    assert not legacy_client.builder.extended_client_commands
+
+    result = legacy_client.sign_psbt(psbt, wallet, None)
+
+    assert result == {
+        0: bytes.fromhex(
+            "304402206b3e877655f08c6e7b1b74d6d893a82cdf799f68a5ae7cecae63a71b0339e5ce022019b94aa3fb6635956e109f3d89c996b1bfbbaf3c619134b5a302badfaf52180e01"
+        ),
+        1: bytes.fromhex(
+            "3045022100e2e98e4f8c70274f10145c89a5d86e216d0376bdf9f42f829e4315ea67d79d210220743589fd4f55e540540a976a5af58acd610fa5e188a5096dfe7d36baf3afb94001"
+        ),
+    }
+
+
+def test_sign_psbt_fail_wrong_p2(client: Client):
+    # Any P2 bit other than PACK_SIGNATURES and CLIENT_EXTENDED_COMMANDS must be rejected with
+    # SW_WRONG_P1P2, before any client command or user interaction
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    for p2 in [0x02, 0x40, 0x83]:
+        apdu = client.builder.sign_psbt({}, [{}], [{}], wallet, None)
+        apdu["p2"] = p2
+        sw, _ = client._apdu_exchange(apdu)
+        assert sw == 0x6A86
+
+
 # def test_sign_psbt_legacy(client: Client):
 #     # legacy address
 #     # PSBT for a legacy 1-input 1-output spend
@@ -403,7 +454,7 @@ def test_sign_psbt_singlesig_wpkh_4to3(client: Client, comm: SpeculosClient, is_
 
 @automation("automations/sign_with_wallet_accept.json")
 def test_sign_psbt_singlesig_wpkh_64to256(client: Client, enable_slow_tests: bool):
-    # PSBT for a transaction with 64 inputs and 256 outputs (maximum currently supported in the app)
+    # PSBT for a transaction with 64 inputs and 256 outputs
     # Very slow test (esp. with DEBUG enabled), so disabled unless the --enableslowtests option is used
 
     if not enable_slow_tests:
@@ -429,6 +480,35 @@ def test_sign_psbt_singlesig_wpkh_64to256(client: Client, enable_slow_tests: boo
     assert len(result) == 64
 
 
+@automation("automations/sign_with_wallet_accept.json")
+def test_sign_psbt_singlesig_wpkh_4to1000(client: Client, enable_slow_tests: bool):
+    # PSBT for a transaction with 4 inputs and 1000 outputs; the outputs are verified one at a time,
+    # so the number of outputs is not limited by the memory of the device.
+    # Very slow test (esp. with DEBUG enabled), so disabled unless the --enableslowtests option is used
+
+    if not enable_slow_tests:
+        pytest.skip()
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    psbt = txmaker.createPsbt(
+        wallet,
+        [10000000 + 10000 * i for i in range(4)],
+        [999 + 9 * i for i in range(1000)],
+        [i == 42 for i in range(1000)]
+    )
+
+    result = client.sign_psbt(psbt, wallet, None)
+
+    assert len(result) == 4
+
+
 def test_sign_psbt_fail_11_changes(client: Client):
     # PSBT for transaction with 11 change addresses; the limit is 10, so it must fail with NotSupportedError
     # before any user interaction
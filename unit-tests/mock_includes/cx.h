@@ -1,4 +1,5 @@
-#pragma once
+// os.h includes cx.h in the middle, and needs the types declared in it
+#include "os.h"
 
 /*******************************************************************************
 *   Ledger Nano S - Secure firmware
@@ -53,7 +54,7 @@
 // #include "lcx_sha3.h"
 // #include "lcx_sha512.h"
 
-// #include "lcx_blake2.h"
+#include "lcx_blake2.h"
 
 // #include "lcx_groestl.h"
 
@@ -61,7 +62,7 @@
 /*                                 HASH MAC                                */
 /* ======================================================================= */
 
-// #include "lcx_hmac.h"
+#include "lcx_hmac.h"
 
 /* ======================================================================= */
 /*                                  PKDF2                                  */
@@ -93,8 +94,8 @@
 
 #include "lcx_ecfp.h"
 
-// #include "lcx_ecdsa.h"
-// #include "lcx_ecschnorr.h"
+#include "lcx_ecdsa.h"
+#include "lcx_ecschnorr.h"
 // #include "lcx_eddsa.h"
 
 /* ======================================================================= */
@@ -113,7 +114,7 @@
 /*                                    MATH                                 */
 /* ======================================================================= */
 
-// #include "lcx_math.h"
+#include "lcx_math.h"
 
 /* ======================================================================= */
 /*                                    DEBUG                                */
@@ -0,0 +1,11 @@
+#pragma once
+
+/* Subset of the error codes of the cryptographic library of the SDK. */
+
+#include <stdint.h>
+
+typedef uint32_t cx_err_t;
+
+#define CX_OK                0x00000000
+#define CX_INVALID_PARAMETER 0xFFFFFF82
+#define CX_EC_INFINITE_POINT 0xFFFFFF41
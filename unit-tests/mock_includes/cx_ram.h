@@ -0,0 +1,16 @@
+#pragma once
+
+/* The cxram section of the SDK, that the app uses as scratch memory for the hashes. */
+
+#include <stdint.h>
+
+#include "cx.h"
+#include "cx_sha256.h"
+#include "cx_ripemd160.h"
+
+union cx_u {
+  cx_sha256_t sha256;
+  cx_ripemd160_t ripemd160;
+};
+
+extern union cx_u G_cx;
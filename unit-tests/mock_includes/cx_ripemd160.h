@@ -0,0 +1,15 @@
+#pragma once
+
+/* Incremental RIPEMD-160 of the cryptographic library of the SDK. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cx_errors.h"
+#include "lcx_ripemd160.h"
+
+cx_err_t cx_ripemd160_init_no_throw(cx_ripemd160_t *hash);
+
+cx_err_t cx_ripemd160_update(cx_ripemd160_t *ctx, const uint8_t *data, size_t len);
+
+cx_err_t cx_ripemd160_final(cx_ripemd160_t *ctx, uint8_t *digest);
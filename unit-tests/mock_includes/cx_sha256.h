@@ -0,0 +1,12 @@
+#pragma once
+
+/* Incremental SHA-256 of the cryptographic library of the SDK. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lcx_sha256.h"
+
+cx_err_t cx_sha256_update(cx_sha256_t *ctx, const uint8_t *data, size_t len);
+
+void cx_sha256_final(cx_sha256_t *ctx, uint8_t *digest);
@@ -0,0 +1,10 @@
+#pragma once
+
+/* BLAKE2b context of the cryptographic library of the SDK; the functions are not implemented. */
+
+struct cx_blake2b_s {
+  struct cx_hash_header_s header;
+  unsigned int output_size;
+  unsigned char ctx[208];
+};
+typedef struct cx_blake2b_s cx_blake2b_t;
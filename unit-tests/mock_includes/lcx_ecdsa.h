@@ -0,0 +1,20 @@
+#pragma once
+
+/* ECDSA signatures of the cryptographic library of the SDK. */
+
+/**
+ * Signs the hash with the private key; the signature is DER-encoded in sig.
+ *
+ * @param [in] mode   CX_RND_RFC6979 for deterministic nonces.
+ * @param [out] info  set to CX_ECCINFO_PARITY_ODD if the y coordinate of the nonce point is odd.
+ *
+ * @return the length of the signature.
+ */
+CXCALL int cx_ecdsa_sign(const cx_ecfp_private_key_t WIDE *pvkey,
+                         int mode,
+                         cx_md_t hashID,
+                         const unsigned char WIDE *hash PLENGTH(hash_len),
+                         unsigned int hash_len,
+                         unsigned char *sig PLENGTH(sig_len),
+                         unsigned int sig_len,
+                         unsigned int *info PLENGTH(sizeof(unsigned int)));
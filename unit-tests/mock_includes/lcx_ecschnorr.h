@@ -0,0 +1,22 @@
+#pragma once
+
+/* Schnorr signatures of the cryptographic library of the SDK. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cx_errors.h"
+
+#define CX_ECSCHNORR_BIP0340 (0 << 12)
+
+/**
+ * Signs the message with the private key; with CX_ECSCHNORR_BIP0340, the signature is the 64-byte one
+ * of BIP-0340.
+ */
+cx_err_t cx_ecschnorr_sign_no_throw(const cx_ecfp_private_key_t *pvkey,
+                                    uint32_t mode,
+                                    cx_md_t hashID,
+                                    const uint8_t *msg,
+                                    size_t msg_len,
+                                    uint8_t *sig,
+                                    size_t *sig_len);
@@ -0,0 +1,27 @@
+#pragma once
+
+/* One-shot HMAC functions of the cryptographic library of the SDK. */
+
+/**
+ * Computes the HMAC-SHA256 of the input with the given key.
+ *
+ * @return the length of the mac, that is truncated to mac_len bytes.
+ */
+CXCALL int cx_hmac_sha256(const unsigned char WIDE *key PLENGTH(key_len),
+                          unsigned int key_len,
+                          const unsigned char WIDE *in PLENGTH(len),
+                          unsigned int len,
+                          unsigned char *mac PLENGTH(mac_len),
+                          unsigned int mac_len);
+
+/**
+ * Computes the HMAC-SHA512 of the input with the given key.
+ *
+ * @return the length of the mac, that is truncated to mac_len bytes.
+ */
+CXCALL int cx_hmac_sha512(const unsigned char WIDE *key PLENGTH(key_len),
+                          unsigned int key_len,
+                          const unsigned char WIDE *in PLENGTH(len),
+                          unsigned int len,
+                          unsigned char *mac PLENGTH(mac_len),
+                          unsigned int mac_len);
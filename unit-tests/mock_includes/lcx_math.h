@@ -0,0 +1,42 @@
+#pragma once
+
+/* Big numbers arithmetic of the cryptographic library of the SDK, on big-endian byte strings. */
+
+/**
+ * Compares a and b; returns 0 if they are equal, a negative value if a < b, a positive one otherwise.
+ */
+CXCALL int cx_math_cmp(const unsigned char WIDE *a PLENGTH(length),
+                       const unsigned char WIDE *b PLENGTH(length),
+                       unsigned int length);
+
+/**
+ * Returns 1 if a is 0, 0 otherwise.
+ */
+CXCALL int cx_math_is_zero(const unsigned char WIDE *a PLENGTH(len), unsigned int len);
+
+/**
+ * r = a - b; returns the borrow.
+ */
+CXCALL int cx_math_sub(unsigned char *r PLENGTH(len),
+                       const unsigned char WIDE *a PLENGTH(len),
+                       const unsigned char WIDE *b PLENGTH(len),
+                       unsigned int len);
+
+/**
+ * r = a + b mod m.
+ */
+CXCALL void cx_math_addm(unsigned char *r PLENGTH(len),
+                         const unsigned char WIDE *a PLENGTH(len),
+                         const unsigned char WIDE *b PLENGTH(len),
+                         const unsigned char WIDE *m PLENGTH(len),
+                         unsigned int len);
+
+/**
+ * r = a^e mod m.
+ */
+CXCALL void cx_math_powm(unsigned char *r PLENGTH(len),
+                         const unsigned char *a PLENGTH(len),
+                         const unsigned char WIDE *e PLENGTH(len_e),
+                         unsigned int len_e,
+                         const unsigned char WIDE *m PLENGTH(len),
+                         unsigned int len);
@@ -19,6 +19,8 @@
 #ifndef LCX_SHA256_H
 #define LCX_SHA256_H
 
+#include "cx_errors.h"
+
 /** SHA224 message digest size */
 #define CX_SHA224_SIZE 28
 /** SHA256 message digest size */
@@ -77,4 +79,13 @@ CXCALL int cx_hash_sha256(const unsigned char WIDE *in PLENGTH(len),
                           unsigned int len, unsigned char *out PLENGTH(out_len),
                           unsigned int out_len);
 
+/**
+ * Initialize a sha256 context, without throwing.
+ *
+ * @param [out] hash the context to init.
+ *
+ * @return CX_OK
+ */
+cx_err_t cx_sha256_init_no_throw(cx_sha256_t *hash);
+
 #endif
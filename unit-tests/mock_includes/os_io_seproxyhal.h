@@ -0,0 +1,31 @@
+#pragma once
+
+/* Stub of the SDK's I/O layer; the APDU buffer, the channels and io_exchange are declared in os.h. */
+
+#include <stdint.h>
+
+#include "os.h"
+
+#define IO_SEPROXYHAL_BUFFER_SIZE_B 128
+
+extern volatile io_apdu_media_t G_io_apdu_media;
+
+typedef struct {
+  unsigned short apdu_length;
+} io_seph_app_t;
+
+extern io_seph_app_t G_io_app;
+
+#define SEPROXYHAL_TAG_BUTTON_PUSH_EVENT              0x05
+#define SEPROXYHAL_TAG_STATUS_EVENT                   0x0E
+#define SEPROXYHAL_TAG_STATUS_EVENT_FLAG_USB_POWERED  0x00000008
+#define SEPROXYHAL_TAG_TICKER_EVENT                   0x0D
+#define SEPROXYHAL_TAG_DISPLAY_PROCESSED_EVENT        0x0F
+
+void io_seproxyhal_init(void);
+void io_seproxyhal_general_status(void);
+unsigned int io_seproxyhal_spi_is_status_sent(void);
+void io_seproxyhal_spi_send(const unsigned char *buffer, unsigned short length);
+unsigned short io_seproxyhal_spi_recv(unsigned char *buffer,
+                                      unsigned short maxlength,
+                                      unsigned int flags);
@@ -0,0 +1,5 @@
+#pragma once
+
+/* Internal header of the SDK; everything the app uses is in lcx_ecfp.h. */
+
+#include "lcx_ecfp.h"
@@ -0,0 +1,34 @@
+#pragma once
+
+/* Stub of the SDK's UX layer: flows are declared, but never displayed. */
+
+#include <stddef.h>
+
+#include "os_io_seproxyhal.h"
+
+typedef struct bagl_element_s {
+  const char *text;
+} bagl_element_t;
+
+typedef struct ux_flow_step_s {
+  const void *params;
+} ux_flow_step_t;
+
+typedef struct {
+  unsigned int stack_count;
+} ux_state_t;
+
+#define UX_STEP_NOCB(stepname, layoutkind, ...) const ux_flow_step_t stepname = {NULL}
+#define UX_FLOW(flowname, ...) const ux_flow_step_t *const flowname[] = {__VA_ARGS__, NULL}
+
+#define UX_INIT()
+#define UX_BUTTON_PUSH_EVENT(seph_packet)
+#define UX_DISPLAYED_EVENT(displayed_callback)
+#define UX_TICKER_EVENT(seph_packet, callback)
+#define UX_DEFAULT_EVENT()
+
+void ux_flow_init(unsigned int stack_slot,
+                  const ux_flow_step_t *const *steps,
+                  const ux_flow_step_t *const start_step);
+
+void io_seproxyhal_display_default(const bagl_element_t *element);
@@ -257,6 +257,34 @@ static void test_buffer_write(void **state) {
     buffer_seek_end(&buf, 8);
     assert_true(buffer_write_u64(&buf, 0x4242424242424242ULL, BE));          // enough space this time 
 
+    // TEST buffer_write_varint
+    memcpy(data, template, sizeof(template));
+    buffer_seek_set(&buf, 1);
+    assert_true(buffer_write_varint(&buf, 0xfc));
+    assert_int_equal(data[1], 0xfc);
+    assert_int_equal(data[2], 0x02);
+    assert_int_equal(buf.offset, 2);
+    assert_true(buffer_write_varint(&buf, 0x1234));
+    assert_int_equal(data[2], 0xfd);
+    assert_int_equal(data[3], 0x34);
+    assert_int_equal(data[4], 0x12);
+    assert_int_equal(data[5], 0x05);
+    assert_int_equal(buf.offset, 5);
+    assert_true(buffer_write_varint(&buf, 0x12345678));
+    assert_int_equal(data[5], 0xfe);
+    assert_int_equal(data[6], 0x78);
+    assert_int_equal(data[9], 0x12);
+    assert_int_equal(data[10], 0x0a);
+    assert_int_equal(buf.offset, 10);
+
+    buffer_seek_end(&buf, 8);
+    assert_false(buffer_write_varint(&buf, 0x4242424242424242ULL));         // not enough space
+    assert_int_equal(data[sizeof(data) - 1], template[sizeof(data) - 1]); // shouldn't change data if not enough space
+    assert_int_equal(buf.offset, sizeof(data) - 8);
+    buffer_seek_end(&buf, 9);
+    assert_true(buffer_write_varint(&buf, 0x4242424242424242ULL));          // enough space this time
+    assert_int_equal(data[sizeof(data) - 9], 0xff);
+    assert_int_equal(buf.offset, sizeof(data));
 }
 
 static void test_buffer_create(void **state) {
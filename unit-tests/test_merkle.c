@@ -0,0 +1,86 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <cmocka.h>
+
+#include "common/merkle.h"
+
+// Checks that the directions computed by merkle_get_leaf_path match merkle_get_ith_direction
+static void check_path(uint32_t size, uint32_t index) {
+    uint32_t directions;
+    int depth = merkle_get_leaf_path(size, index, &directions);
+
+    assert_true(depth >= 0 && depth <= ceil_lg(size));
+
+    for (int i = 0; i < depth; i++) {
+        assert_int_equal((directions >> i) & 1, merkle_get_ith_direction(size, index, i));
+    }
+    // no bits are set beyond the depth of the leaf
+    assert_int_equal(directions >> depth, 0);
+
+    // there are no more directions after the leaf
+    assert_int_equal(merkle_get_ith_direction(size, index, depth), -1);
+}
+
+static void test_merkle_leaf_path_small_trees(void **state) {
+    (void) state;
+
+    // all the leaves of all the trees with up to 1024 leaves
+    for (uint32_t size = 1; size <= 1024; size++) {
+        for (uint32_t index = 0; index < size; index++) {
+            check_path(size, index);
+        }
+    }
+}
+
+static void test_merkle_leaf_path_large_trees(void **state) {
+    (void) state;
+
+    // Not exhaustive: beyond 1024 leaves, only the trees of size 2^k - 1, 2^k and 2^k + 1 are
+    // checked, for 11 <= k <= 16 (all their leaves).
+    for (int k = 11; k <= 16; k++) {
+        uint32_t sizes[] = {(1 << k) - 1, 1 << k, (1 << k) + 1};
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            for (uint32_t index = 0; index < sizes[i]; index++) {
+                check_path(sizes[i], index);
+            }
+        }
+    }
+}
+
+static void test_merkle_leaf_path_depth(void **state) {
+    (void) state;
+
+    uint32_t directions;
+
+    // a tree with a single leaf has an empty path
+    assert_int_equal(merkle_get_leaf_path(1, 0, &directions), 0);
+    assert_int_equal(directions, 0);
+
+    // in a complete tree, all the leaves have the same depth
+    for (uint32_t index = 0; index < 1 << 16; index++) {
+        assert_int_equal(merkle_get_leaf_path(1 << 16, index, &directions), 16);
+    }
+
+    // in a tree with 2^16 + 1 leaves, the last leaf is the right child of the root
+    assert_int_equal(merkle_get_leaf_path((1 << 16) + 1, 1 << 16, &directions), 1);
+    assert_int_equal(directions, 1);
+
+    // invalid indexes
+    assert_int_equal(merkle_get_leaf_path(0, 0, &directions), -1);
+    assert_int_equal(merkle_get_leaf_path(5, 5, &directions), -1);
+    assert_int_equal(merkle_get_leaf_path(5, 100, &directions), -1);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_merkle_leaf_path_small_trees),
+        cmocka_unit_test(test_merkle_leaf_path_large_trees),
+        cmocka_unit_test(test_merkle_leaf_path_depth),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -307,6 +307,94 @@ static void test_parser_error(void **state) {
     assert_int_equal(parser_state.a, 0xa0a1a2a3);  // a should have been parsed correctly
 }
 
+static void test_dbuffer_read_ptr(void **state) {
+    (void) state;
+
+    uint8_t store[32] = {0x00, 0x01, 0x02, 0x03};
+    uint8_t stream[32] = {0x04, 0x05, 0x06, 0x07, 0x08, 0x09};
+
+    buffer_t store_buf = buffer_create(store, 4);
+    buffer_t stream_buf = buffer_create(stream, 6);
+    buffer_t *buffers[2] = {&store_buf, &stream_buf};
+
+    uint8_t tmp[8] = {0};
+    const uint8_t *data;
+
+    // entirely in the store: no copy
+    data = dbuffer_read_ptr(buffers, tmp, 3);
+    assert_ptr_equal(data, store);
+
+    // straddling the two buffers: copied in tmp
+    data = dbuffer_read_ptr(buffers, tmp, 3);
+    assert_ptr_equal(data, tmp);
+    assert_int_equal(tmp[0], 0x03);
+    assert_int_equal(tmp[1], 0x04);
+    assert_int_equal(tmp[2], 0x05);
+    assert_int_equal(store_buf.offset, 4);
+    assert_int_equal(stream_buf.offset, 2);
+
+    // entirely in the stream: no copy
+    data = dbuffer_read_ptr(buffers, tmp, 2);
+    assert_ptr_equal(data, stream + 2);
+
+    // not enough data: the buffers are not modified
+    data = dbuffer_read_ptr(buffers, tmp, 3);
+    assert_null(data);
+    assert_int_equal(store_buf.offset, 4);
+    assert_int_equal(stream_buf.offset, 4);
+
+    data = dbuffer_read_ptr(buffers, tmp, 2);
+    assert_ptr_equal(data, stream + 4);
+    assert_false(dbuffer_can_read(buffers, 1));
+}
+
+static void test_dbuffer_read_available(void **state) {
+    (void) state;
+
+    uint8_t store[32] = {0x00, 0x01, 0x02};
+    uint8_t stream[32] = {0x03, 0x04, 0x05, 0x06, 0x07};
+
+    buffer_t store_buf = buffer_create(store, 3);
+    buffer_t stream_buf = buffer_create(stream, 5);
+    buffer_t *buffers[2] = {&store_buf, &stream_buf};
+
+    const uint8_t *data;
+
+    // never returns more than what is left in the store, even if more is requested
+    assert_int_equal(dbuffer_read_available(buffers, 2, &data), 2);
+    assert_ptr_equal(data, store);
+    assert_int_equal(dbuffer_read_available(buffers, 100, &data), 1);
+    assert_ptr_equal(data, store + 2);
+
+    // once the store is exhausted, reads from the stream
+    assert_int_equal(dbuffer_read_available(buffers, 100, &data), 5);
+    assert_ptr_equal(data, stream);
+
+    assert_int_equal(dbuffer_read_available(buffers, 100, &data), 0);
+}
+
+static void test_dbuffer_read_varint(void **state) {
+    (void) state;
+
+    // a 1-byte varint, and a 5-byte varint split between the two buffers
+    uint8_t store[32] = {0xfc, 0xfe, 0x01, 0x02};
+    uint8_t stream[32] = {0x03, 0x04, 0xfd};
+
+    buffer_t store_buf = buffer_create(store, 4);
+    buffer_t stream_buf = buffer_create(stream, 3);
+    buffer_t *buffers[2] = {&store_buf, &stream_buf};
+
+    uint64_t value;
+    assert_true(dbuffer_read_varint(buffers, &value));
+    assert_int_equal(value, 0xfc);
+    assert_true(dbuffer_read_varint(buffers, &value));
+    assert_int_equal(value, 0x04030201);
+
+    // incomplete 3-byte varint
+    assert_false(dbuffer_read_varint(buffers, &value));
+    assert_int_equal(stream_buf.offset, 2);
+}
+
 int main() {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_parser_init_context),
@@ -316,6 +404,9 @@ int main() {
         cmocka_unit_test(test_parser_stream_ends),
         cmocka_unit_test(test_parser_continue_partial),
         cmocka_unit_test(test_parser_error),
+        cmocka_unit_test(test_dbuffer_read_ptr),
+        cmocka_unit_test(test_dbuffer_read_available),
+        cmocka_unit_test(test_dbuffer_read_varint),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,311 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <cmocka.h>
+
+// The parser is tested together with its static parsing steps; the client commands and the hash
+// functions it uses are replaced by the stubs below.
+#include "handler/lib/psbt_parse_rawtx.c"
+
+#include "common/varint.h"
+
+#define MAX_TEST_TX_LEN 4096
+
+// Size of the largest piece of a preimage returned by the client in a single response
+#define MAX_CHUNK_SIZE 253
+
+// A transaction in its full serialization, and in the serialization used to compute the txid (that
+// is, without the segwit marker, flag and witnesses)
+typedef struct {
+    uint8_t full[MAX_TEST_TX_LEN];
+    size_t full_len;
+    uint8_t stripped[MAX_TEST_TX_LEN];
+    size_t stripped_len;
+} test_tx_t;
+
+static const uint8_t *G_stream_data;
+static size_t G_stream_data_len;
+static size_t G_chunk_size;
+
+static uint8_t G_hashed_data[MAX_TEST_TX_LEN];
+static size_t G_hashed_data_len;
+
+void *pic(void *linked_address) {
+    return linked_address;
+}
+
+int cx_sha256_init(cx_sha256_t *hash) {
+    (void) hash;
+
+    G_hashed_data_len = 0;
+    return CX_SHA256;
+}
+
+// Records the data that is hashed, instead of hashing it
+int cx_hash(cx_hash_t *hash,
+            int mode,
+            const unsigned char *in,
+            unsigned int len,
+            unsigned char *out,
+            unsigned int out_len) {
+    (void) hash;
+
+    assert_true(G_hashed_data_len + len <= sizeof(G_hashed_data));
+    if (len > 0) {
+        memcpy(G_hashed_data + G_hashed_data_len, in, len);
+        G_hashed_data_len += len;
+    }
+    if (mode & CX_LAST) {
+        memset(out, 0, out_len);
+    }
+    return 0;
+}
+
+int cx_hash_sha256(const unsigned char *in,
+                   unsigned int len,
+                   unsigned char *out,
+                   unsigned int out_len) {
+    (void) in, (void) len;
+
+    memset(out, 0, out_len);
+    return 32;
+}
+
+int call_get_merkleized_map_value_hash(dispatcher_context_t *dispatcher_context,
+                                       const merkleized_map_commitment_t *map,
+                                       const uint8_t *key,
+                                       int key_len,
+                                       uint8_t out[static 32]) {
+    (void) dispatcher_context, (void) map, (void) key, (void) key_len;
+
+    memset(out, 0, 32);
+    return 0;
+}
+
+// Passes the data to the callback in pieces of G_chunk_size bytes (the last one might be shorter)
+int call_stream_preimage(dispatcher_context_t *dispatcher_context,
+                         const uint8_t hash[static 32],
+                         void (*len_callback)(size_t, void *),
+                         void (*callback)(buffer_t *, void *),
+                         void *callback_state) {
+    (void) dispatcher_context, (void) hash;
+
+    if (len_callback != NULL) {
+        len_callback(G_stream_data_len, callback_state);
+    }
+
+    for (size_t offset = 0; offset < G_stream_data_len; offset += G_chunk_size) {
+        size_t chunk_len = G_stream_data_len - offset < G_chunk_size ? G_stream_data_len - offset
+                                                                      : G_chunk_size;
+        buffer_t chunk = buffer_create((void *) (G_stream_data + offset), chunk_len);
+        callback(&chunk, callback_state);
+    }
+    return (int) G_stream_data_len;
+}
+
+static void tx_append(test_tx_t *tx, const uint8_t *data, size_t len, bool is_stripped) {
+    assert_true(tx->full_len + len <= sizeof(tx->full));
+    memcpy(tx->full + tx->full_len, data, len);
+    tx->full_len += len;
+
+    if (is_stripped) {
+        memcpy(tx->stripped + tx->stripped_len, data, len);
+        tx->stripped_len += len;
+    }
+}
+
+static void tx_append_varint(test_tx_t *tx, uint64_t value, bool is_stripped) {
+    uint8_t tmp[9];
+    int len = varint_write(tmp, 0, value);
+    tx_append(tx, tmp, len, is_stripped);
+}
+
+// Appends len bytes of recognizable data, different for each seed
+static void tx_append_data(test_tx_t *tx, size_t len, uint8_t seed, bool is_stripped) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t byte = (uint8_t) (seed * 31 + i * 7);
+        tx_append(tx, &byte, 1, is_stripped);
+    }
+}
+
+static uint64_t output_value(size_t index) {
+    return 100000000ULL * (index + 1) + 12345;
+}
+
+// Builds a transaction with the given lengths of the scriptSigs and of the scriptPubKeys. If
+// witness_lens is not NULL, the transaction is segwit, and each input has a witness with elements
+// of the given lengths.
+static void build_tx(test_tx_t *tx,
+                     const size_t *scriptsig_lens,
+                     size_t n_inputs,
+                     const size_t *scriptpubkey_lens,
+                     size_t n_outputs,
+                     const size_t *witness_lens,
+                     size_t n_witness_elements) {
+    memset(tx, 0, sizeof(*tx));
+
+    tx_append(tx, (const uint8_t[]){0x02, 0x00, 0x00, 0x00}, 4, true);  // version
+    if (witness_lens != NULL) {
+        tx_append(tx, (const uint8_t[]){0x00, 0x01}, 2, false);  // marker and flag
+    }
+
+    tx_append_varint(tx, n_inputs, true);
+    for (size_t i = 0; i < n_inputs; i++) {
+        tx_append_data(tx, 32, (uint8_t) (10 + i), true);                          // prevout txid
+        tx_append(tx, (const uint8_t[]){(uint8_t) i, 0x00, 0x00, 0x00}, 4, true);  // prevout n
+        tx_append_varint(tx, scriptsig_lens[i], true);
+        tx_append_data(tx, scriptsig_lens[i], (uint8_t) (20 + i), true);
+        tx_append(tx, (const uint8_t[]){0xfd, 0xff, 0xff, 0xff}, 4, true);  // nSequence
+    }
+
+    tx_append_varint(tx, n_outputs, true);
+    for (size_t i = 0; i < n_outputs; i++) {
+        uint8_t value[8];
+        write_u64_le(value, 0, output_value(i));
+        tx_append(tx, value, 8, true);
+        tx_append_varint(tx, scriptpubkey_lens[i], true);
+        tx_append_data(tx, scriptpubkey_lens[i], (uint8_t) (40 + i), true);
+    }
+
+    if (witness_lens != NULL) {
+        for (size_t i = 0; i < n_inputs; i++) {
+            tx_append_varint(tx, n_witness_elements, false);
+            for (size_t j = 0; j < n_witness_elements; j++) {
+                tx_append_varint(tx, witness_lens[j], false);
+                tx_append_data(tx, witness_lens[j], (uint8_t) (60 + i + j), false);
+            }
+        }
+    }
+
+    tx_append(tx, (const uint8_t[]){0x11, 0x22, 0x33, 0x44}, 4, true);  // locktime
+}
+
+static int run_parser(const uint8_t *data,
+                      size_t data_len,
+                      size_t chunk_size,
+                      int output_index,
+                      txid_parser_outputs_t *outputs) {
+    machine_context_t machine_context = {0};
+    dispatcher_context_t dc = {.machine_context_ptr = &machine_context};
+    merkleized_map_commitment_t map = {0};
+
+    G_stream_data = data;
+    G_stream_data_len = data_len;
+    G_chunk_size = chunk_size;
+
+    memset(outputs, 0, sizeof(*outputs));
+    return call_psbt_parse_rawtx(&dc, &map, (const uint8_t[]){0x00}, 1, output_index, outputs);
+}
+
+// Parses the transaction in pieces of every size, checking that the data added to the hash and the
+// extracted output are always the same, however the fields are split between the pieces
+static void check_parse_tx(const test_tx_t *tx, int output_index, const size_t *scriptpubkey_lens) {
+    for (size_t chunk_size = 1; chunk_size <= MAX_CHUNK_SIZE; chunk_size++) {
+        txid_parser_outputs_t outputs;
+        assert_int_equal(run_parser(tx->full, tx->full_len, chunk_size, output_index, &outputs), 0);
+
+        assert_int_equal(G_hashed_data_len, tx->stripped_len);
+        assert_memory_equal(G_hashed_data, tx->stripped, tx->stripped_len);
+
+        if (output_index != -1) {
+            test_tx_t expected_script;
+            memset(&expected_script, 0, sizeof(expected_script));
+            tx_append_data(&expected_script,
+                           scriptpubkey_lens[output_index],
+                           (uint8_t) (40 + output_index),
+                           false);
+
+            assert_true(outputs.vout_value == output_value(output_index));
+            assert_int_equal(outputs.vout_scriptpubkey_len, scriptpubkey_lens[output_index]);
+            assert_memory_equal(outputs.vout_scriptpubkey,
+                                expected_script.full,
+                                scriptpubkey_lens[output_index]);
+        }
+    }
+}
+
+static void test_psbt_parse_rawtx_legacy(void **state) {
+    (void) state;
+
+    static test_tx_t tx;
+
+    // scripts of every length class: empty, shorter and longer than the store, and with a 3-byte
+    // varint length (only for outputs that are not extracted)
+    const size_t scriptsig_lens[] = {0, 107, 300, 31};
+    const size_t scriptpubkey_lens[] = {25, 34, 300, 0, 22};
+
+    build_tx(&tx, scriptsig_lens, 4, scriptpubkey_lens, 5, NULL, 0);
+
+    for (int output_index = -1; output_index < 5; output_index++) {
+        if (output_index == 2) {
+            continue;  // the scriptPubKey is too long to be extracted
+        }
+        check_parse_tx(&tx, output_index, scriptpubkey_lens);
+    }
+}
+
+static void test_psbt_parse_rawtx_segwit(void **state) {
+    (void) state;
+
+    static test_tx_t tx;
+
+    const size_t scriptsig_lens[] = {0, 23};
+    const size_t scriptpubkey_lens[] = {34, 22, 260};
+    const size_t witness_lens[] = {72, 0, 33, 300};
+
+    build_tx(&tx, scriptsig_lens, 2, scriptpubkey_lens, 3, witness_lens, 4);
+
+    for (int output_index = -1; output_index < 2; output_index++) {
+        check_parse_tx(&tx, output_index, scriptpubkey_lens);
+    }
+}
+
+static void test_psbt_parse_rawtx_scriptpubkey_too_long(void **state) {
+    (void) state;
+
+    static test_tx_t tx;
+
+    const size_t scriptsig_lens[] = {107};
+    const size_t scriptpubkey_lens[] = {22, MAX_PREVOUT_SCRIPTPUBKEY_LEN + 1};
+
+    build_tx(&tx, scriptsig_lens, 1, scriptpubkey_lens, 2, NULL, 0);
+
+    // the error of the output parser must not be lost in the parser of the whole transaction
+    for (size_t chunk_size = 1; chunk_size <= MAX_CHUNK_SIZE; chunk_size++) {
+        txid_parser_outputs_t outputs;
+        assert_int_equal(run_parser(tx.full, tx.full_len, chunk_size, 1, &outputs), -1);
+    }
+}
+
+static void test_psbt_parse_rawtx_wrong_segwit_flag(void **state) {
+    (void) state;
+
+    static test_tx_t tx;
+
+    const size_t scriptsig_lens[] = {0};
+    const size_t scriptpubkey_lens[] = {22};
+    const size_t witness_lens[] = {72};
+
+    build_tx(&tx, scriptsig_lens, 1, scriptpubkey_lens, 1, witness_lens, 1);
+    tx.full[5] = 0x02;  // the flag following the 0x00 marker must be 0x01
+
+    for (size_t chunk_size = 1; chunk_size <= MAX_CHUNK_SIZE; chunk_size++) {
+        txid_parser_outputs_t outputs;
+        assert_int_equal(run_parser(tx.full, tx.full_len, chunk_size, 0, &outputs), -1);
+    }
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_psbt_parse_rawtx_legacy),
+        cmocka_unit_test(test_psbt_parse_rawtx_segwit),
+        cmocka_unit_test(test_psbt_parse_rawtx_scriptpubkey_too_long),
+        cmocka_unit_test(test_psbt_parse_rawtx_wrong_segwit_flag),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}